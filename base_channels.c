@@ -44,6 +44,7 @@ void init_base_channels (const struct context_rmcios *context)
    init_system_channels (context);
    init_util_channels (context);
    init_encoding_channels (context);
+   init_compression_channels (context);
 }
 
 #ifdef INDEPENDENT_CHANNEL_MODULE
@@ -39,6 +39,7 @@ extern void init_math_channels(const struct context_rmcios *context) ;
 extern void init_system_channels(const struct context_rmcios *context) ;
 extern void init_util_channels(const struct context_rmcios *context) ;
 extern void init_encoding_channels(const struct context_rmcios *context) ;
+extern void init_compression_channels(const struct context_rmcios *context) ;
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,78 @@
+/* 
+RMCIOS - Reactive Multipurpose Control Input Output System
+Copyright (c) 2018 Frans Korhonen
+
+RMCIOS was originally developed at Institute for Atmospheric 
+and Earth System Research / Physics, Faculty of Science, 
+University of Helsinki, Finland
+
+Assistance, experience and feedback from following persons have been 
+critical for development of RMCIOS: Erkki Siivola, Juha Kangasluoma, 
+Lauri Ahonen, Ella Häkkinen, Pasi Aalto, Joonas Enroth, Runlong Cai, 
+Markku Kulmala and Tuukka Petäjä.
+
+This file is part of RMCIOS. This notice was encoded using utf-8.
+
+RMCIOS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RMCIOS is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public Licenses
+along with RMCIOS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Byte scanning shared by the channel modules. Aligned data is tested
+ * 8 bytes at a time.
+ *
+ * Changelog: (date,who,description)
+ */
+#ifndef BYTE_SCAN_H
+#define BYTE_SCAN_H
+
+#include <stddef.h>
+
+#ifdef __GNUC__
+typedef unsigned long long __attribute__ ((may_alias)) scan_word;
+#define SCAN_ONES (~(scan_word) 0 / 0xFF)
+#define SCAN_HIGHS (SCAN_ONES * 0x80)
+// Nonzero when some byte of v is zero
+#define SCAN_HASZERO(v) (((v) - SCAN_ONES) & ~(v) & SCAN_HIGHS)
+#endif
+
+// Find first byte that equals c1 or c2.
+// Returns length when neither was found.
+static inline int scan_bytes (const unsigned char *data, int length,
+                              unsigned char c1, unsigned char c2)
+{
+   int i = 0;
+#ifdef __GNUC__
+   scan_word p1 = SCAN_ONES * c1;
+   scan_word p2 = SCAN_ONES * c2;
+   while (i < length && ((size_t) (data + i) & (sizeof (scan_word) - 1)))
+   {
+      if (data[i] == c1 || data[i] == c2)
+         return i;
+      i++;
+   }
+   for (; i + (int) sizeof (scan_word) <= length; i += sizeof (scan_word))
+   {
+      scan_word v = *(const scan_word *) (data + i);
+      if (SCAN_HASZERO (v ^ p1) | SCAN_HASZERO (v ^ p2))
+         break;
+   }
+#endif
+   for (; i < length; i++)
+   {
+      if (data[i] == c1 || data[i] == c2)
+         return i;
+   }
+   return length;
+}
+
+#endif
@@ -0,0 +1,1102 @@
+/* 
+RMCIOS - Reactive Multipurpose Control Input Output System
+Copyright (c) 2018 Frans Korhonen
+
+RMCIOS was originally developed at Institute for Atmospheric 
+and Earth System Research / Physics, Faculty of Science, 
+University of Helsinki, Finland
+
+Assistance, experience and feedback from following persons have been 
+critical for development of RMCIOS: Erkki Siivola, Juha Kangasluoma, 
+Lauri Ahonen, Ella Häkkinen, Pasi Aalto, Joonas Enroth, Runlong Cai, 
+Markku Kulmala and Tuukka Petäjä.
+
+This file is part of RMCIOS. This notice was encoded using utf-8.
+
+RMCIOS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RMCIOS is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public Licenses
+along with RMCIOS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Compression channels module implementation.
+ *
+ * Changelog: (date,who,description)
+ */
+#include "RMCIOS-functions.h"
+
+////////////////////////////////////////////////////////////////////////
+// Bit stream helpers (MSB first)
+////////////////////////////////////////////////////////////////////////
+struct bit_writer
+{
+   unsigned char *data;
+   int length;                  // complete bytes in data
+   unsigned long long acc;      // bits not yet stored to data
+   int bits;
+};
+
+static void bits_write (struct bit_writer *w, unsigned int value, int bits)
+{
+   w->acc = w->acc << bits | (value & (0xFFFFFFFFu >> (32 - bits)));
+   w->bits += bits;
+   while (w->bits >= 8)
+   {
+      w->bits -= 8;
+      w->data[w->length++] = (unsigned char) (w->acc >> w->bits);
+   }
+}
+
+// Store the last partial byte padded with zeros
+static void bits_flush (struct bit_writer *w)
+{
+   if (w->bits > 0)
+      w->data[w->length++] = (unsigned char) (w->acc << (8 - w->bits));
+   w->bits = 0;
+   w->acc = 0;
+}
+
+struct bit_reader
+{
+   const unsigned char *data;
+   int length;
+   int index;                   // next byte to read
+   unsigned long long acc;
+   int bits;
+   char overrun;                // read past the end of data
+};
+
+static unsigned int bits_read (struct bit_reader *r, int bits)
+{
+   while (r->bits < bits)
+   {
+      if (r->index < r->length)
+         r->acc = r->acc << 8 | r->data[r->index++];
+      else
+      {
+         r->acc <<= 8;
+         r->overrun = 1;
+      }
+      r->bits += 8;
+   }
+   r->bits -= bits;
+   return (unsigned int) (r->acc >> r->bits) & (0xFFFFFFFFu >> (32 - bits));
+}
+
+static int count_leading_zeros (unsigned int x)
+{
+#ifdef __GNUC__
+   return __builtin_clz (x);
+#else
+   int n = 0;
+   while ((x & 0x80000000u) == 0)
+   {
+      x <<= 1;
+      n++;
+   }
+   return n;
+#endif
+}
+
+static int count_trailing_zeros (unsigned int x)
+{
+#ifdef __GNUC__
+   return __builtin_ctz (x);
+#else
+   int n = 0;
+   while ((x & 1) == 0)
+   {
+      x >>= 1;
+      n++;
+   }
+   return n;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////
+// Float time series compression channels.
+// Timestamps are delta-of-delta encoded and values are XOR encoded
+// against the previous value (Gorilla, Facebook 2015).
+//
+// Block format:
+//   16 bits: number of samples
+//   32 bits: first timestamp
+//   32 bits: first value
+//   for each following sample:
+//     timestamp delta-of-delta:
+//       '0'              = 0
+//       '10'   + 7 bits  = -64..63
+//       '110'  + 9 bits  = -256..255
+//       '1110' + 12 bits = -2048..2047
+//       '1111' + 32 bits
+//     value XOR with previous:
+//       '0'  = same value
+//       '10' + meaningful bits within previous leading/trailing zeros
+//       '11' + 5 bits leading zeros + 5 bits (length - 1)
+//            + meaningful bits
+////////////////////////////////////////////////////////////////////////
+// Samples per write of decompressor
+#define TIMESERIES_CHUNK 256
+
+struct timeseries_data
+{
+   // Configuration
+   int block_size;              // samples in compressed block
+   int timestamp_channel;       // decompressor timestamp output
+
+   // Compressor block state
+   struct bit_writer block;
+   int count;
+   int timestamp;
+   int delta;
+   unsigned int value;
+   int leading;
+   int trailing;                // -1=no previous window
+   float latest;
+};
+
+// Worst case bits of one sample after the first one is 80 bits.
+#define TIMESERIES_BLOCK_BYTES(samples) ((samples) * 10 + 12)
+
+// Send the compressed block to linked channels and start new block
+static void timeseries_flush (const struct context_rmcios *context, int id,
+                              struct timeseries_data *this)
+{
+   if (this->count == 0)
+      return;
+   bits_flush (&this->block);
+   this->block.data[0] = (unsigned char) (this->count >> 8);
+   this->block.data[1] = (unsigned char) this->count;
+   write_buffer (context, linked_channels (context, id),
+                 (const char *) this->block.data, this->block.length, 0);
+   this->count = 0;
+}
+
+// Add sample to the compressed block
+static void timeseries_compress (struct timeseries_data *this,
+                                 int timestamp, float value)
+{
+   struct bit_writer *w = &this->block;
+   union
+   {
+      float f;
+      unsigned int u;
+   } v;
+   v.f = value;
+
+   if (this->count == 0)
+   {
+      // Block header. Sample count is filled on flush.
+      w->length = 2;
+      w->bits = 0;
+      w->acc = 0;
+      bits_write (w, (unsigned int) timestamp, 32);
+      bits_write (w, v.u, 32);
+      this->delta = 0;
+      this->trailing = -1;
+   }
+   else
+   {
+      int delta = timestamp - this->timestamp;
+      int dod = delta - this->delta;
+      unsigned int x = v.u ^ this->value;
+
+      if (dod == 0)
+         bits_write (w, 0, 1);
+      else if (dod >= -64 && dod <= 63)
+      {
+         bits_write (w, 2, 2);
+         bits_write (w, dod, 7);
+      }
+      else if (dod >= -256 && dod <= 255)
+      {
+         bits_write (w, 6, 3);
+         bits_write (w, dod, 9);
+      }
+      else if (dod >= -2048 && dod <= 2047)
+      {
+         bits_write (w, 14, 4);
+         bits_write (w, dod, 12);
+      }
+      else
+      {
+         bits_write (w, 15, 4);
+         bits_write (w, dod, 32);
+      }
+      this->delta = delta;
+
+      if (x == 0)
+         bits_write (w, 0, 1);
+      else
+      {
+         int leading = count_leading_zeros (x);
+         int trailing = count_trailing_zeros (x);
+         if (this->trailing >= 0
+             && leading >= this->leading && trailing >= this->trailing)
+         {
+            // Meaningful bits fit to the previous window
+            bits_write (w, 2, 2);
+            bits_write (w, x >> this->trailing,
+                        32 - this->leading - this->trailing);
+         }
+         else
+         {
+            int length = 32 - leading - trailing;
+            if (leading > 31)
+               leading = 31;
+            bits_write (w, 3, 2);
+            bits_write (w, leading, 5);
+            bits_write (w, length - 1, 5);
+            bits_write (w, x >> trailing, length);
+            this->leading = leading;
+            this->trailing = trailing;
+         }
+      }
+   }
+   this->timestamp = timestamp;
+   this->value = v.u;
+   this->count++;
+}
+
+// Decoder state of compressed block
+struct timeseries_reader
+{
+   struct bit_reader r;
+   int count;                   // samples in block
+   int index;                   // next sample
+   int timestamp;
+   int delta;
+   int leading;
+   int trailing;
+   unsigned int value;
+};
+
+// Read block header. Returns number of samples in block.
+static int timeseries_reader_init (struct timeseries_reader *d,
+                                   const unsigned char *data, int length)
+{
+   d->r.data = data;
+   d->r.length = length;
+   d->r.index = 0;
+   d->r.acc = 0;
+   d->r.bits = 0;
+   d->r.overrun = 0;
+   d->count = 0;
+   d->index = 0;
+   d->timestamp = 0;
+   d->value = 0;
+   d->delta = 0;
+   d->leading = 0;
+   d->trailing = 0;
+   if (length < 10)
+      return 0;
+   d->count = bits_read (&d->r, 16);
+   d->timestamp = (int) bits_read (&d->r, 32);
+   d->value = bits_read (&d->r, 32);
+   return d->count;
+}
+
+// Decode up to max_samples next samples. Returns number of samples.
+// Returns 0 at the end of block or on corrupted data.
+static int timeseries_decompress (struct timeseries_reader *d,
+                                  int max_samples, int *timestamps,
+                                  float *values)
+{
+   union
+   {
+      float f;
+      unsigned int u;
+   } v;
+   int n;
+
+   v.u = d->value;
+   for (n = 0; n < max_samples && d->index < d->count; n++, d->index++)
+   {
+      if (d->index > 0)
+      {
+         struct bit_reader *r = &d->r;
+         int dod;
+         if (bits_read (r, 1) == 0)
+            dod = 0;
+         else if (bits_read (r, 1) == 0)
+            dod = ((int) bits_read (r, 7) << 25) >> 25;
+         else if (bits_read (r, 1) == 0)
+            dod = ((int) bits_read (r, 9) << 23) >> 23;
+         else if (bits_read (r, 1) == 0)
+            dod = ((int) bits_read (r, 12) << 20) >> 20;
+         else
+            dod = (int) bits_read (r, 32);
+         d->delta += dod;
+         d->timestamp += d->delta;
+
+         if (bits_read (r, 1) != 0)
+         {
+            if (bits_read (r, 1) != 0)
+            {
+               d->leading = bits_read (r, 5);
+               d->trailing = 32 - d->leading - (bits_read (r, 5) + 1);
+               if (d->trailing < 0)
+               {
+                  d->count = d->index;        // Corrupted block
+                  break;
+               }
+            }
+            v.u ^= bits_read (r, 32 - d->leading - d->trailing)
+               << d->trailing;
+         }
+         if (r->overrun)
+         {
+            d->count = d->index;
+            break;
+         }
+      }
+      timestamps[n] = d->timestamp;
+      values[n] = v.f;
+   }
+   d->value = v.u;
+   return n;
+}
+
+static void timeseries_create (const struct context_rmcios *context,
+                               struct timeseries_data **data,
+                               enum type_rmcios paramtype,
+                               const union param_rmcios param,
+                               class_rmcios class_func)
+{
+   struct timeseries_data *this;
+   this = (struct timeseries_data *)
+          allocate_storage (context, sizeof (struct timeseries_data), 0);
+   *data = this;
+   if (this == 0)
+      return;
+   this->block_size = 120;
+   this->timestamp_channel = 0;
+   this->count = 0;
+   this->timestamp = 0;
+   this->latest = 0;
+   this->block.data = 0;
+   this->block.length = 0;
+   create_channel_param (context, paramtype, param, 0, class_func, this);
+}
+
+void timeseries_compressor_class_func (struct timeseries_data *this,
+                                       const struct context_rmcios *context,
+                                       int id, enum function_rmcios function,
+                                       enum type_rmcios paramtype,
+                                       struct combo_rmcios *returnv,
+                                       int num_params,
+                                       const union param_rmcios param)
+{
+   switch (function)
+   {
+   case help_rmcios:
+      return_string (context, returnv,
+                     "time series compressor - compress float values with"
+                     " delta-of-delta timestamps and XOR encoded values\r\n"
+                     "create ts_compress newname\r\n"
+                     "setup newname block_size(120)\r\n"
+                     "  -samples in one compressed block (max 65535)\r\n"
+                     "write newname value | timestamp\r\n"
+                     "  -add sample to block. Without timestamp"
+                     " the sample index is used.\r\n"
+                     "  -full block is sent to linked channels as"
+                     " single write\r\n"
+                     "write newname\r\n"
+                     "  -send partial block to linked channels\r\n"
+                     "read newname\r\n"
+                     "  -latest value\r\n"
+                     "link newname channel\r\n");
+      break;
+
+   case create_rmcios:
+      if (num_params < 1)
+         break;
+      timeseries_create (context, &this, paramtype, param,
+                         (class_rmcios) timeseries_compressor_class_func);
+      if (this == 0)
+         break;
+      this->block.data = (unsigned char *)
+         allocate_storage (context,
+                           TIMESERIES_BLOCK_BYTES (this->block_size), 0);
+      if (this->block.data == 0)
+         this->block_size = 0;
+      break;
+
+   case setup_rmcios:
+      if (this == 0)
+         break;
+      if (num_params < 1)
+         break;
+      {
+         int block_size = param_to_int (context, paramtype, param, 0);
+         if (block_size < 1)
+            block_size = 1;
+         if (block_size > 65535)
+            block_size = 65535;
+         timeseries_flush (context, id, this);
+         if (this->block.data != 0)
+            free_storage (context, this->block.data, 0);
+         this->block.data = (unsigned char *)
+            allocate_storage (context, TIMESERIES_BLOCK_BYTES (block_size),
+                              0);
+         this->block_size = (this->block.data != 0) ? block_size : 0;
+      }
+      break;
+
+   case write_rmcios:
+      if (this == 0)
+         break;
+      if (num_params < 1)
+      {
+         timeseries_flush (context, id, this);
+         break;
+      }
+      if (this->block_size == 0)
+         break;
+      {
+         int timestamp;
+         this->latest = param_to_float (context, paramtype, param, 0);
+         if (num_params >= 2)
+            timestamp = param_to_int (context, paramtype, param, 1);
+         else
+            timestamp = (this->count == 0) ? 0 : this->timestamp + 1;
+         timeseries_compress (this, timestamp, this->latest);
+         if (this->count >= this->block_size)
+            timeseries_flush (context, id, this);
+      }
+      break;
+
+   case read_rmcios:
+      if (this == 0)
+         break;
+      return_float (context, returnv, this->latest);
+      break;
+   }
+}
+
+void timeseries_decompressor_class_func (struct timeseries_data *this,
+                                         const struct context_rmcios *context,
+                                         int id,
+                                         enum function_rmcios function,
+                                         enum type_rmcios paramtype,
+                                         struct combo_rmcios *returnv,
+                                         int num_params,
+                                         const union param_rmcios param)
+{
+   switch (function)
+   {
+   case help_rmcios:
+      return_string (context, returnv,
+                     "time series decompressor - decompress blocks"
+                     " of ts_compress channel\r\n"
+                     "create ts_decompress newname\r\n"
+                     "setup newname timestamp_channel\r\n"
+                     "  -channel for the timestamps of decompressed block\r\n"
+                     "write newname block\r\n"
+                     "  -decompress block. Values are sent to linked channels"
+                     " in writes of up to 256 values.\r\n"
+                     "read newname\r\n"
+                     "  -latest value\r\n"
+                     "link newname channel\r\n");
+      break;
+
+   case create_rmcios:
+      if (num_params < 1)
+         break;
+      timeseries_create (context, &this, paramtype, param,
+                         (class_rmcios) timeseries_decompressor_class_func);
+      break;
+
+   case setup_rmcios:
+      if (this == 0)
+         break;
+      if (num_params < 1)
+         break;
+      this->timestamp_channel = param_to_int (context, paramtype, param, 0);
+      break;
+
+   case write_rmcios:
+      if (this == 0)
+         break;
+      if (num_params < 1)
+         break;
+      {
+         int blen = param_binary_length (context, paramtype, param, 0);
+         char buffer[paramtype == buffer_rmcios ? 1 : blen];
+         struct buffer_rmcios p;
+         struct timeseries_reader reader;
+         int timestamps[TIMESERIES_CHUNK];
+         float values[TIMESERIES_CHUNK];
+         int n;
+
+         if (paramtype == buffer_rmcios)
+            p = param.bv[0];
+         else
+            p = param_to_binary (context, paramtype, param, 0, blen, buffer);
+         timeseries_reader_init (&reader, (const unsigned char *) p.data,
+                                 p.length);
+         // Send in fixed size chunks. Block can hold 65535 samples.
+         while ((n = timeseries_decompress (&reader, TIMESERIES_CHUNK,
+                                            timestamps, values)) > 0)
+         {
+            this->latest = values[n - 1];
+            if (this->timestamp_channel != 0)
+               write_iv (context, this->timestamp_channel, n, timestamps);
+            write_fv (context, linked_channels (context, id), n, values);
+         }
+      }
+      break;
+
+   case read_rmcios:
+      if (this == 0)
+         break;
+      return_float (context, returnv, this->latest);
+      break;
+   }
+}
+
+////////////////////////////////////////////////////////////////////////
+// LZ stream compression channels.
+// LZ4 style byte oriented compression with history window carried
+// between blocks. Memory use is fixed by the block and window sizes.
+//
+// Block format:
+//   16 bits: block length (big endian). Bit 15 set = stored uncompressed.
+//   sequences:
+//     token: 4 bits literal length, 4 bits match length - 4
+//            (value 15 continues with bytes of 255 + last byte < 255)
+//     literal bytes
+//     16 bits: match offset (little endian) back into window
+//   Block can end after literals or after a match.
+////////////////////////////////////////////////////////////////////////
+#define LZ_HASH_BITS 12
+#define LZ_HASH_SIZE (1 << LZ_HASH_BITS)
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_BLOCK 32767
+#define LZ_MAX_WINDOW 65535
+#define LZ_RAW_BLOCK 0x8000
+
+struct lz_data
+{
+   // Configuration
+   int block_size;
+   int window;
+
+   // History window followed by the current block
+   unsigned char *buffer;
+   int history;                 // bytes of history in start of buffer
+   int length;                  // bytes of current block after history
+   unsigned int position;       // stream position of buffer[0]
+   unsigned int *hash;          // stream positions of 4 byte sequences
+
+   // Compressed block with header
+   unsigned char *frame;
+   int received;                // decompressor: received frame bytes
+
+   unsigned int bytes_in;
+   unsigned int bytes_out;
+};
+
+static unsigned int lz_read32 (const unsigned char *p)
+{
+   return p[0] | p[1] << 8 | p[2] << 16 | (unsigned int) p[3] << 24;
+}
+
+#define LZ_HASH(sequence) (((sequence) * 2654435761u) >> (32 - LZ_HASH_BITS))
+
+static void lz_copy (unsigned char *dst, const unsigned char *src, int n)
+{
+   while (n-- > 0)
+      *dst++ = *src++;
+}
+
+// Write extended length bytes
+static int lz_length (unsigned char *out, int op, int n)
+{
+   while (n >= 255)
+   {
+      out[op++] = 255;
+      n -= 255;
+   }
+   out[op++] = (unsigned char) n;
+   return op;
+}
+
+// Append sequence to out. Returns new output index or -1 when the
+// sequence does not fit under limit. offset 0 = literals only.
+static int lz_sequence (unsigned char *out, int op, int limit,
+                        const unsigned char *literals, int literal_length,
+                        int offset, int match_length)
+{
+   int token = op++;
+   int needed = 1 + literal_length + literal_length / 255 + 1;
+   if (offset != 0)
+      needed += 2 + match_length / 255 + 1;
+   if (op - 1 + needed > limit)
+      return -1;
+
+   if (literal_length >= 15)
+   {
+      out[token] = 15 << 4;
+      op = lz_length (out, op, literal_length - 15);
+   }
+   else
+      out[token] = (unsigned char) (literal_length << 4);
+   lz_copy (out + op, literals, literal_length);
+   op += literal_length;
+
+   if (offset != 0)
+   {
+      match_length -= LZ_MIN_MATCH;
+      out[op++] = (unsigned char) offset;
+      out[op++] = (unsigned char) (offset >> 8);
+      if (match_length >= 15)
+      {
+         out[token] |= 15;
+         op = lz_length (out, op, match_length - 15);
+      }
+      else
+         out[token] |= (unsigned char) match_length;
+   }
+   return op;
+}
+
+// Compress buffer[start..end). Matches may reference window bytes
+// before start. Returns compressed length or 0 when result would
+// not be shorter than limit.
+static int lz_compress_block (const unsigned char *buffer, int start,
+                              int end, unsigned int position, int window,
+                              unsigned int *hash, unsigned char *out,
+                              int limit)
+{
+   int i = start;
+   int anchor = start;
+   int op = 0;
+   int misses = 0;
+
+   while (i <= end - LZ_MIN_MATCH)
+   {
+      unsigned int sequence = lz_read32 (buffer + i);
+      unsigned int h = LZ_HASH (sequence);
+      unsigned int distance = position + i - hash[h];
+      int match, length;
+      hash[h] = position + i;
+
+      if (distance == 0 || distance > (unsigned int) window
+          || distance > (unsigned int) i
+          || lz_read32 (buffer + i - distance) != sequence)
+      {
+         // Skip faster through data that does not compress
+         i += 1 + (misses++ >> 6);
+         continue;
+      }
+      misses = 0;
+
+      match = i - distance;
+      length = LZ_MIN_MATCH;
+      while (i + length < end && buffer[match + length] == buffer[i + length])
+         length++;
+      while (i > anchor && match > 0 && buffer[match - 1] == buffer[i - 1])
+      {
+         i--;
+         match--;
+         length++;
+      }
+
+      op = lz_sequence (out, op, limit, buffer + anchor, i - anchor,
+                        distance, length);
+      if (op < 0)
+         return 0;
+      i += length;
+      anchor = i;
+      if (i - 2 <= end - LZ_MIN_MATCH)
+         hash[LZ_HASH (lz_read32 (buffer + i - 2))] = position + i - 2;
+   }
+
+   if (anchor < end)
+   {
+      op = lz_sequence (out, op, limit, buffer + anchor, end - anchor, 0, 0);
+      if (op < 0)
+         return 0;
+   }
+   return op;
+}
+
+// Decompress block to buffer starting from start. Matches may reference
+// bytes before start. Returns end of decompressed data or -1 on corrupted
+// block.
+static int lz_decompress_block (const unsigned char *in, int length,
+                                unsigned char *buffer, int start, int limit)
+{
+   int ip = 0;
+   int op = start;
+
+   while (ip < length)
+   {
+      int token = in[ip++];
+      int n = token >> 4;
+      int offset, c;
+
+      if (n == 15)
+         do
+         {
+            if (ip >= length)
+               return -1;
+            c = in[ip++];
+            n += c;
+         }
+         while (c == 255);
+      if (n > length - ip || n > limit - op)
+         return -1;
+      lz_copy (buffer + op, in + ip, n);
+      ip += n;
+      op += n;
+      if (ip == length)
+         break;
+
+      if (ip + 2 > length)
+         return -1;
+      offset = in[ip] | in[ip + 1] << 8;
+      ip += 2;
+      n = token & 15;
+      if (n == 15)
+         do
+         {
+            if (ip >= length)
+               return -1;
+            c = in[ip++];
+            n += c;
+         }
+         while (c == 255);
+      n += LZ_MIN_MATCH;
+      if (offset == 0 || offset > op || n > limit - op)
+         return -1;
+      // Overlapping copy repeats the pattern
+      lz_copy (buffer + op, buffer + op - offset, n);
+      op += n;
+   }
+   return op;
+}
+
+// Keep the last window bytes as history for the next block
+static void lz_slide (struct lz_data *this)
+{
+   int total = this->history + this->length;
+   int keep = total < this->window ? total : this->window;
+   lz_copy (this->buffer, this->buffer + total - keep, keep);
+   this->position += total - keep;
+   this->history = keep;
+   this->length = 0;
+}
+
+// Compress current block and send it to linked channels
+static void lz_flush (const struct context_rmcios *context, int id,
+                      struct lz_data *this)
+{
+   int length;
+   if (this->length == 0)
+      return;
+   length = lz_compress_block (this->buffer, this->history,
+                               this->history + this->length, this->position,
+                               this->window, this->hash, this->frame + 2,
+                               this->length - 1);
+   if (length == 0)
+   {
+      length = this->length;
+      lz_copy (this->frame + 2, this->buffer + this->history, length);
+      this->frame[0] = (unsigned char) ((length | LZ_RAW_BLOCK) >> 8);
+   }
+   else
+      this->frame[0] = (unsigned char) (length >> 8);
+   this->frame[1] = (unsigned char) length;
+   this->bytes_out += length + 2;
+   write_buffer (context, linked_channels (context, id),
+                 (const char *) this->frame, length + 2, 0);
+   lz_slide (this);
+}
+
+// Decompress received frame and send the data to linked channels
+static void lz_frame_received (const struct context_rmcios *context, int id,
+                               struct lz_data *this)
+{
+   int header = this->frame[0] << 8 | this->frame[1];
+   int length = header & ~LZ_RAW_BLOCK;
+   int end;
+
+   this->bytes_in += length + 2;
+   if (header & LZ_RAW_BLOCK)
+   {
+      lz_copy (this->buffer + this->history, this->frame + 2, length);
+      end = this->history + length;
+   }
+   else
+      end = lz_decompress_block (this->frame + 2, length, this->buffer,
+                                 this->history,
+                                 this->history + this->block_size);
+   this->received = 0;
+   if (end < 0)
+   {
+      // Corrupted block. History is not valid anymore.
+      this->history = 0;
+      this->length = 0;
+      return;
+   }
+   this->length = end - this->history;
+   this->bytes_out += this->length;
+   write_buffer (context, linked_channels (context, id),
+                 (const char *) this->buffer + this->history,
+                 this->length, 0);
+   lz_slide (this);
+}
+
+// (Re)allocate buffers. Returns 0 on failure.
+static int lz_allocate (const struct context_rmcios *context,
+                        struct lz_data *this, int block_size, int window,
+                        int compressor)
+{
+   int i;
+   if (this->buffer != 0)
+      free_storage (context, this->buffer, 0);
+   if (this->hash != 0)
+      free_storage (context, this->hash, 0);
+   if (this->frame != 0)
+      free_storage (context, this->frame, 0);
+   this->hash = 0;
+   this->block_size = 0;
+   this->history = 0;
+   this->length = 0;
+   this->received = 0;
+
+   this->buffer = (unsigned char *)
+      allocate_storage (context, window + block_size, 0);
+   this->frame = (unsigned char *)
+      allocate_storage (context, block_size + 2, 0);
+   if (compressor)
+   {
+      this->hash = (unsigned int *)
+         allocate_storage (context, LZ_HASH_SIZE * sizeof (unsigned int), 0);
+      if (this->hash != 0)
+         for (i = 0; i < LZ_HASH_SIZE; i++)
+            this->hash[i] = 0;
+   }
+   if (this->buffer == 0 || this->frame == 0 || (compressor && this->hash == 0))
+      return 0;
+   this->block_size = block_size;
+   this->window = window;
+   return 1;
+}
+
+static void lz_class_func (struct lz_data *this,
+                           const struct context_rmcios *context, int id,
+                           enum function_rmcios function,
+                           enum type_rmcios paramtype,
+                           struct combo_rmcios *returnv,
+                           int num_params, const union param_rmcios param,
+                           class_rmcios class_func, int compressor)
+{
+   switch (function)
+   {
+   case create_rmcios:
+      if (num_params < 1)
+         break;
+      this = (struct lz_data *)
+         allocate_storage (context, sizeof (struct lz_data), 0);
+      if (this == 0)
+         break;
+      this->buffer = 0;
+      this->hash = 0;
+      this->frame = 0;
+      this->position = 0;
+      this->bytes_in = 0;
+      this->bytes_out = 0;
+      lz_allocate (context, this, 4096, 8192, compressor);
+      create_channel_param (context, paramtype, param, 0, class_func, this);
+      break;
+
+   case setup_rmcios:
+      if (this == 0)
+         break;
+      if (num_params < 1)
+         break;
+      {
+         int block_size = param_to_int (context, paramtype, param, 0);
+         int window = this->window;
+         if (num_params >= 2)
+            window = param_to_int (context, paramtype, param, 1);
+         if (block_size < 16)
+            block_size = 16;
+         if (block_size > LZ_MAX_BLOCK)
+            block_size = LZ_MAX_BLOCK;
+         if (window < 0)
+            window = 0;
+         if (window > LZ_MAX_WINDOW)
+            window = LZ_MAX_WINDOW;
+         if (compressor && this->block_size > 0)
+            lz_flush (context, id, this);
+         lz_allocate (context, this, block_size, window, compressor);
+      }
+      break;
+
+   case write_rmcios:
+      if (this == 0)
+         break;
+      if (num_params < 1)
+      {
+         if (compressor && this->block_size > 0)
+            lz_flush (context, id, this);
+         break;
+      }
+      if (this->block_size == 0)
+         break;
+      {
+         int blen = param_binary_length (context, paramtype, param, 0);
+         char buffer[paramtype == buffer_rmcios ? 1 : blen];
+         struct buffer_rmcios p;
+         const unsigned char *data;
+         int n;
+
+         if (paramtype == buffer_rmcios)
+            p = param.bv[0];
+         else
+            p = param_to_binary (context, paramtype, param, 0, blen, buffer);
+         data = (const unsigned char *) p.data;
+
+         while (p.length > 0)
+         {
+            if (compressor)
+            {
+               // Collect data to block. Full block is compressed.
+               n = this->block_size - this->length;
+               if (n > p.length)
+                  n = p.length;
+               lz_copy (this->buffer + this->history + this->length, data, n);
+               this->length += n;
+               this->bytes_in += n;
+               if (this->length == this->block_size)
+                  lz_flush (context, id, this);
+            }
+            else if (this->received < 2)
+            {
+               // Block header
+               n = 1;
+               this->frame[this->received++] = *data;
+               if (this->received == 2
+                   && ((this->frame[0] << 8 | this->frame[1])
+                       & ~LZ_RAW_BLOCK) > this->block_size)
+               {
+                  // Block does not fit. Resynchronize from next byte.
+                  this->frame[0] = this->frame[1];
+                  this->received = 1;
+               }
+            }
+            else
+            {
+               int length = (this->frame[0] << 8 | this->frame[1])
+                  & ~LZ_RAW_BLOCK;
+               n = length + 2 - this->received;
+               if (n > p.length)
+                  n = p.length;
+               lz_copy (this->frame + this->received, data, n);
+               this->received += n;
+               if (this->received == length + 2)
+                  lz_frame_received (context, id, this);
+            }
+            data += n;
+            p.length -= n;
+         }
+         if (!compressor && this->received == 2
+             && (this->frame[0] << 8 | this->frame[1]) == 0)
+            this->received = 0;
+      }
+      break;
+
+   case read_rmcios:
+      if (this == 0)
+         break;
+      {
+         unsigned int compressed = compressor ? this->bytes_out
+                                              : this->bytes_in;
+         unsigned int raw = compressor ? this->bytes_in : this->bytes_out;
+         return_float (context, returnv,
+                       raw == 0 ? 0 : (float) compressed / raw);
+      }
+      break;
+   }
+}
+
+void lz_compressor_class_func (struct lz_data *this,
+                               const struct context_rmcios *context, int id,
+                               enum function_rmcios function,
+                               enum type_rmcios paramtype,
+                               struct combo_rmcios *returnv,
+                               int num_params,
+                               const union param_rmcios param)
+{
+   if (function == help_rmcios)
+      return_string (context, returnv,
+                     "lz compressor - LZ4 style stream compression\r\n"
+                     "create lz_compress newname\r\n"
+                     "setup newname block_size(4096) | window(8192)\r\n"
+                     "  -block_size: uncompressed bytes in block (16-32767)\r\n"
+                     "  -window: bytes of earlier data referenced by"
+                     " matches (0-65535)\r\n"
+                     "write newname data\r\n"
+                     "  -add data to block. Full compressed block is sent"
+                     " to linked channels as single write.\r\n"
+                     "write newname\r\n"
+                     "  -compress and send partial block\r\n"
+                     "read newname\r\n"
+                     "  -compression ratio (compressed/uncompressed bytes)\r\n"
+                     "link newname channel\r\n");
+   else
+      lz_class_func (this, context, id, function, paramtype, returnv,
+                     num_params, param,
+                     (class_rmcios) lz_compressor_class_func, 1);
+}
+
+void lz_decompressor_class_func (struct lz_data *this,
+                                 const struct context_rmcios *context, int id,
+                                 enum function_rmcios function,
+                                 enum type_rmcios paramtype,
+                                 struct combo_rmcios *returnv,
+                                 int num_params,
+                                 const union param_rmcios param)
+{
+   if (function == help_rmcios)
+      return_string (context, returnv,
+                     "lz decompressor - decompress lz_compress stream\r\n"
+                     "create lz_decompress newname\r\n"
+                     "setup newname block_size(4096) | window(8192)\r\n"
+                     "  -sizes must be at least the compressor sizes\r\n"
+                     "write newname data\r\n"
+                     "  -blocks can be split to any number of writes."
+                     " Each decompressed block is sent to linked channels"
+                     " as single write.\r\n"
+                     "read newname\r\n"
+                     "  -compression ratio (compressed/uncompressed bytes)\r\n"
+                     "link newname channel\r\n");
+   else
+      lz_class_func (this, context, id, function, paramtype, returnv,
+                     num_params, param,
+                     (class_rmcios) lz_decompressor_class_func, 0);
+}
+
+void init_compression_channels (const struct context_rmcios *context)
+{
+   create_channel_str (context, "ts_compress",
+                       (class_rmcios) timeseries_compressor_class_func, 0);
+   create_channel_str (context, "ts_decompress",
+                       (class_rmcios) timeseries_decompressor_class_func, 0);
+   create_channel_str (context, "lz_compress",
+                       (class_rmcios) lz_compressor_class_func, 0);
+   create_channel_str (context, "lz_decompress",
+                       (class_rmcios) lz_decompressor_class_func, 0);
+}
@@ -33,6 +33,26 @@ along with RMCIOS.  If not, see <http://www.gnu.org/licenses/>.
  * Changelog: (date,who,description)
  */
 #include "RMCIOS-functions.h"
+#include "byte_scan.h"
+
+/* Compare strings (glibc)*/
+static int strcmp (const char *p1, const char *p2)
+{
+   const unsigned char *s1 = (const unsigned char *) p1;
+   const unsigned char *s2 = (const unsigned char *) p2;
+   unsigned char c1, c2;
+
+   do
+   {
+      c1 = (unsigned char) *s1++;
+      c2 = (unsigned char) *s2++;
+      if (c1 == '\0')
+         return c1 - c2;
+   }
+   while (c1 == c2);
+
+   return c1 - c2;
+}
 
 static const char base64_encoding_table[] =
    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
@@ -68,6 +88,99 @@ char base64_encode (unsigned char *reg, unsigned char c)
    return data;
 }
 
+// Maximum number of base64 symbols produced from len input bytes
+// by base64_encode_block including the possible partial group.
+#define BASE64_ENCODED_SIZE(len) ((((len) + 2) / 3) * 4 + 4)
+
+// Encode block of binary data to base64.
+// Continues from the partial group state in *reg (same format as
+// base64_encode) and leaves the state of the unfinished group to *reg.
+// Returns the number of symbols written to out.
+int base64_encode_block (unsigned char *reg, const unsigned char *in,
+                         int len, char *out)
+{
+   const char *t = base64_encoding_table;
+   char *o = out;
+   int i = 0;
+
+   // Complete the group left over from previous block
+   while ((*reg) >> 6 != 0 && i < len)
+   {
+      *o++ = base64_encode (reg, in[i++]);
+      if ((*reg) >> 6 == 3)
+         *o++ = base64_encode (reg, 0);
+   }
+
+   // Whole 3 byte -> 4 symbol groups, 4 groups per round
+   for (; i + 12 <= len; i += 12, o += 16)
+   {
+      unsigned long g0 = (unsigned long) in[i] << 16
+                         | in[i + 1] << 8 | in[i + 2];
+      unsigned long g1 = (unsigned long) in[i + 3] << 16
+                         | in[i + 4] << 8 | in[i + 5];
+      unsigned long g2 = (unsigned long) in[i + 6] << 16
+                         | in[i + 7] << 8 | in[i + 8];
+      unsigned long g3 = (unsigned long) in[i + 9] << 16
+                         | in[i + 10] << 8 | in[i + 11];
+      o[0] = t[g0 >> 18];
+      o[1] = t[(g0 >> 12) & 0x3F];
+      o[2] = t[(g0 >> 6) & 0x3F];
+      o[3] = t[g0 & 0x3F];
+      o[4] = t[g1 >> 18];
+      o[5] = t[(g1 >> 12) & 0x3F];
+      o[6] = t[(g1 >> 6) & 0x3F];
+      o[7] = t[g1 & 0x3F];
+      o[8] = t[g2 >> 18];
+      o[9] = t[(g2 >> 12) & 0x3F];
+      o[10] = t[(g2 >> 6) & 0x3F];
+      o[11] = t[g2 & 0x3F];
+      o[12] = t[g3 >> 18];
+      o[13] = t[(g3 >> 12) & 0x3F];
+      o[14] = t[(g3 >> 6) & 0x3F];
+      o[15] = t[g3 & 0x3F];
+   }
+   for (; i + 3 <= len; i += 3, o += 4)
+   {
+      unsigned long g = (unsigned long) in[i] << 16
+                        | in[i + 1] << 8 | in[i + 2];
+      o[0] = t[g >> 18];
+      o[1] = t[(g >> 12) & 0x3F];
+      o[2] = t[(g >> 6) & 0x3F];
+      o[3] = t[g & 0x3F];
+   }
+
+   // Start of the next partial group
+   for (; i < len; i++)
+      *o++ = base64_encode (reg, in[i]);
+
+   return o - out;
+}
+
+// Write the remaining symbol and padding of unfinished group to out
+// and reset the encoding state. Returns the number of written symbols.
+int base64_encode_final (unsigned char *reg, char *out)
+{
+   int n = 0;
+   if ((*reg) >> 6 != 0)
+   {
+      // write the remaining symbol
+      out[n++] = base64_encode (reg, 0);
+   }
+   if ((*reg) >> 6 == 3)
+   {
+      // pad with "="
+      out[n++] = '=';
+   }
+   if ((*reg) >> 6 == 2)
+   {
+      // pad with "=="
+      out[n++] = '=';
+      out[n++] = '=';
+   }
+   *reg = 0;
+   return n;
+}
+
 static const char base64_decoding_table[] = {
 // +:   
    62,
@@ -132,10 +245,141 @@ int base64_decode (unsigned char *reg, unsigned char c)
    return rvalue;
 }
 
+// Symbol classes of base64_symbol_table for the bulk decoder.
+#define XX 0xFF                 // invalid symbol
+#define SP 0x40                 // whitespace, skipped
+#define PD 0x41                 // padding '='
+static const unsigned char base64_symbol_table[256] = {
+   XX, XX, XX, XX, XX, XX, XX, XX, XX, SP, SP, XX, XX, SP, XX, XX,
+   XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+   SP, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, 62, XX, XX, XX, 63,
+   52, 53, 54, 55, 56, 57, 58, 59, 60, 61, XX, XX, XX, PD, XX, XX,
+   XX, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14,
+   15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, XX, XX, XX, XX, XX,
+   XX, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+   41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, XX, XX, XX, XX, XX,
+   XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+   XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+   XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+   XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+   XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+   XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+   XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+   XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX
+};
+#undef XX
+#undef SP
+#undef PD
+
+// Decoder state in reg for a group that still expects second '='
+#define BASE64_PAD_PENDING 0x04
+
+// Maximum number of bytes decoded from len symbols by base64_decode_block
+#define BASE64_DECODED_SIZE(len) (((len) / 4) * 3 + 3)
+
+// Decode block of base64 symbols.
+// Continues from the partial group state in *reg (same format as
+// base64_decode) and leaves the state of the unfinished group to *reg.
+// Whitespace is skipped and padding terminates the group.
+// Invalid symbols reset the group. Offset of the first invalid symbol
+// is stored to *invalid (-1 when all symbols were valid).
+// Returns the number of bytes written to out.
+int base64_decode_block (unsigned char *reg, const unsigned char *in,
+                         int len, char *out, int *invalid)
+{
+   const unsigned char *t = base64_symbol_table;
+   char *o = out;
+   int i = 0;
+   *invalid = -1;
+
+   while (i < len)
+   {
+      // Whole groups of 4 symbols. All symbols are validated at once
+      // by testing the class bits of the combined table values.
+      if (*reg == 0)
+      {
+         for (; i + 8 <= len; i += 8, o += 6)
+         {
+            unsigned char a = t[in[i]], b = t[in[i + 1]];
+            unsigned char c = t[in[i + 2]], d = t[in[i + 3]];
+            unsigned char e = t[in[i + 4]], f = t[in[i + 5]];
+            unsigned char g = t[in[i + 6]], h = t[in[i + 7]];
+            if ((a | b | c | d | e | f | g | h) & 0xC0)
+               break;
+            o[0] = a << 2 | b >> 4;
+            o[1] = b << 4 | c >> 2;
+            o[2] = c << 6 | d;
+            o[3] = e << 2 | f >> 4;
+            o[4] = f << 4 | g >> 2;
+            o[5] = g << 6 | h;
+         }
+         for (; i + 4 <= len; i += 4, o += 3)
+         {
+            unsigned char a = t[in[i]], b = t[in[i + 1]];
+            unsigned char c = t[in[i + 2]], d = t[in[i + 3]];
+            if ((a | b | c | d) & 0xC0)
+               break;
+            o[0] = a << 2 | b >> 4;
+            o[1] = b << 4 | c >> 2;
+            o[2] = c << 6 | d;
+         }
+         if (i >= len)
+            break;
+      }
+
+      // Single symbol through the state machine
+      {
+         unsigned char index = t[in[i]];
+         if (index < 0x40)
+         {
+            int c = base64_decode (reg, base64_encoding_table[index]);
+            if (c >= 0)
+               *o++ = c;
+         }
+         else if (index == 0x41)
+         {
+            switch (*reg)
+            {
+            case BASE64_PAD_PENDING:
+               *reg = 0;
+               break;
+            default:
+               if (((*reg) & 3) == 2)
+                  *reg = BASE64_PAD_PENDING;
+               else if (((*reg) & 3) == 3)
+                  *reg = 0;
+               else
+               {
+                  // Padding without preceding symbols.
+                  if (*invalid < 0)
+                     *invalid = i;
+                  *reg = 0;
+               }
+               break;
+            }
+         }
+         else if (index != 0x40)
+         {
+            if (*invalid < 0)
+               *invalid = i;
+            *reg = 0;
+         }
+         i++;
+      }
+   }
+   return o - out;
+}
+
+
+// Size of the reusable base64 output buffer
+#define BASE64_OUTPUT_SIZE 256
 
 struct base64_data
 {
    unsigned char state;
+   unsigned int position;       // decoded stream offset since reset
+   int error_offset;            // offset of first invalid symbol
+   char *out;                   // reusable output buffer
 };
 
 // Channel to base64 encode binary data
@@ -154,9 +398,11 @@ void base64_encoder_class_func (struct base64_data *this,
                      "- channel for encoding binary data\r\n"
                      "create base64_encoder newname\r\n"
                      "write newname data\r\n"
-                     "  -Sum the data in buffer form to the checksum\r\n"
+                     "  -encode data. Encoded data is sent to linked channels\r\n"
+                     "   in writes of up to 256 symbols\r\n"
                      "write newname\r\n"
                      "  -pad the encoded data and reset encoding machinge.\r\n"
+                     "  -padding is sent to linked channels\r\n"
                      "link newname channel\r\n"
                      "  -link encoded output to a channel\r\n");
 
@@ -171,95 +417,75 @@ void base64_encoder_class_func (struct base64_data *this,
             break;
       }
       this->state = 0;
+      this->position = 0;
+      this->error_offset = -1;
+      this->out = (char *) allocate_storage (context, BASE64_OUTPUT_SIZE, 0);
       // create the channel
       create_channel_param (context, paramtype, param, 0, 
                             (class_rmcios) base64_encoder_class_func, this); 
       break;
 
    case write_rmcios:
-      if (this == 0)    
-      // Run directly without parameters
-      {
-         if (num_params < 1)
-            break;
-         unsigned char state = 0;
-         int plen = param_buffer_alloc_size (context, paramtype, param, 0);
-         {
-            char buffer[plen];
-            struct buffer_rmcios buf;
-            int i;
-
-            buf = param_to_buffer (context, paramtype, param, 0, plen, buffer);
-
-            for (i = 0; i < buf.length; i++)
-            {
-               char c;
-               c = base64_encode (&state, buf.data[i]);
-               return_buffer (context, returnv, &c, 1);
-
-               if ((state >> 6) == 3)
-               {
-                  c = base64_encode (&state, 0);
-                  return_buffer (context, returnv, &c, 1);
-               }
-            }
-            if ((state >> 6) != 0)
-            {
-               char c;
-               c = base64_encode (&state, 0);
-               // write the remaining symbol
-               return_buffer (context, returnv, &c, 1);      
-            }
-            if ((state >> 6) == 3)
-               // pad with "="
-               return_string (context, returnv, "=");        
-            if ((state >> 6) == 2)
-               // pad with "=="
-               return_string (context, returnv, "==");       
-         }
+      if (this == 0 && num_params < 1)
          break;
-      }
       if (num_params < 1)       
       // PAD & reset
       {
-         if ((this->state) >> 6 != 0)
+         char encoded[4];
+         int n = base64_encode_final (&(this->state), encoded);
+         if (n > 0)
          {
-            char c;
-            c = base64_encode (&(this->state), 0);
-            // write the remaining symbol
-            return_buffer (context, returnv, &c, 1); 
+            write_buffer (context, linked_channels (context, id),
+                          encoded, n, 0);
+            return_buffer (context, returnv, encoded, n);
          }
-         if (((this->state) >> 6) == 3)
-            // pad with "="
-            return_string (context, returnv, "=");   
-         if (((this->state) >> 6) == 2)
-            // pad with "=="
-            return_string (context, returnv, "==");  
-         this->state = 0;
       }
       else      
-      // feed data
+      // feed data. Direct call without channel also pads the result.
       {
          int plen = param_buffer_alloc_size (context, paramtype, param, 0);
          {
-            char buffer[plen];
+            char buffer[paramtype == buffer_rmcios ? 1 : plen];
+            char local[BASE64_OUTPUT_SIZE];
+            unsigned char direct_state = 0;
+            unsigned char *state = &direct_state;
+            char *out = local;
             struct buffer_rmcios buf;
-            int i;
-
-            buf = param_to_buffer (context, paramtype, param, 0, plen, buffer);
-
-            for (i = 0; i < buf.length; i++)
+            int i, n;
+            // Whole groups that fit to the output with the pending group
+            int step = (BASE64_OUTPUT_SIZE / 4 - 1) * 3;
+
+            if (paramtype == buffer_rmcios)
+               buf = param.bv[0];
+            else
+               buf = param_to_buffer (context, paramtype, param, 0, plen,
+                                      buffer);
+            if (this != 0)
             {
-               char c;
-               c = base64_encode (&this->state, buf.data[i]);
-               write_buffer (context, linked_channels (context, id), &c, 1, 0);
+               state = &this->state;
+               if (this->out != 0)
+                  out = this->out;
+            }
 
-               if ((this->state >> 6) == 3)
-               {
-                  c = base64_encode (&(this->state), 0);
-                  write_buffer (context,
-                                linked_channels (context, id), &c, 1, 0);
-               }
+            // Encode in chunks that fit to the output buffer
+            for (i = 0; i < buf.length; i += step)
+            {
+               int count = buf.length - i;
+               if (count > step)
+                  count = step;
+               n = base64_encode_block (state,
+                                        (const unsigned char *) buf.data + i,
+                                        count, out);
+               if (this == 0)
+                  return_buffer (context, returnv, out, n);
+               else if (n > 0)
+                  write_buffer (context, linked_channels (context, id),
+                                out, n, 0);
+            }
+            if (this == 0)
+            {
+               n = base64_encode_final (state, out);
+               return_buffer (context, returnv, out, n);
             }
          }
       }
@@ -283,8 +509,14 @@ void base64_decoder_class_func (struct base64_data *this,
                      "create base64_decoder newname\r\n"
                      "write newname data\r\n"
                      "  -decode data\r\n"
+                     "  -whitespace is skipped, padding ends the group\r\n"
+                     "  -decoded data is sent to linked channels\r\n"
+                     "   in writes of up to 256 bytes\r\n"
                      "write newname\r\n"
                      "  -reset the encoding machine.\r\n"
+                     "read newname\r\n"
+                     "  -offset of first invalid symbol since reset."
+                     " -1 when none\r\n"
                      "link newname channel\r\n"
                      "  -link decoded output to a channel\r\n");
 
@@ -299,77 +531,160 @@ void base64_decoder_class_func (struct base64_data *this,
             break;
       }
       this->state = 0;
+      this->position = 0;
+      this->error_offset = -1;
+      this->out = (char *) allocate_storage (context, BASE64_OUTPUT_SIZE, 0);
       // create the channel
       create_channel_param (context, paramtype, param, 0, 
                             (class_rmcios) base64_decoder_class_func, this);      
       break;
 
    case write_rmcios:
-      if (this == 0)    
-      // Run directly without inter-call memory.
-      {
-         if (num_params < 1)
-            break;
-         unsigned char state = 0;
-         int plen = param_buffer_alloc_size (context, paramtype, param, 0);
-         {
-            char buffer[plen];
-            struct buffer_rmcios buf;
-            int i;
-
-            buf = param_to_buffer (context, paramtype, param, 0, plen, buffer);
-            for (i = 0; i < buf.length; i++)
-            {
-               int c;
-               char ch;
-               c = base64_decode (&state, buf.data[i]);
-               ch = c;
-               if (c >= 0)
-                  return_buffer (context, returnv, &ch, 1);
-            }
-         }
-         break;
-      }
       if (num_params < 1)       
       // Reset decoding machine
       {
+         if (this == 0)
+            break;
          this->state = 0;
+         this->position = 0;
+         this->error_offset = -1;
       }
       else      
-      // feed data and decode
+      // feed data and decode. Direct call runs without inter-call memory.
       {
          int plen = param_buffer_alloc_size (context, paramtype, param, 0);
          {
-            char buffer[plen];
+            char buffer[paramtype == buffer_rmcios ? 1 : plen];
+            char local[BASE64_OUTPUT_SIZE];
+            unsigned char direct_state = 0;
+            unsigned char *state = &direct_state;
+            char *out = local;
             struct buffer_rmcios buf;
             int i;
+            // Whole groups that fit to the output with the pending group
+            int step = (BASE64_OUTPUT_SIZE / 3 - 1) * 4;
+
+            if (paramtype == buffer_rmcios)
+               buf = param.bv[0];
+            else
+               buf = param_to_buffer (context, paramtype, param, 0, plen,
+                                      buffer);
+            if (this != 0)
+            {
+               state = &this->state;
+               if (this->out != 0)
+                  out = this->out;
+            }
 
-            buf = param_to_buffer (context, paramtype, param, 0, plen, buffer);
-            for (i = 0; i < buf.length; i++)
+            // Decode in chunks that fit to the output buffer
+            for (i = 0; i < buf.length; i += step)
             {
-               int c;
-               c = base64_decode (&(this->state), buf.data[i]);
-               if (c >= 0)
-                  return_buffer (context, returnv, (char *) &c, 1);
+               int invalid;
+               int n;
+               int count = buf.length - i;
+               if (count > step)
+                  count = step;
+               n = base64_decode_block (state,
+                                        (const unsigned char *) buf.data + i,
+                                        count, out, &invalid);
+               if (this == 0)
+               {
+                  return_buffer (context, returnv, out, n);
+                  continue;
+               }
+               if (invalid >= 0 && this->error_offset < 0)
+                  this->error_offset = this->position + invalid;
+               this->position += count;
+
+               if (n > 0)
+               {
+                  write_buffer (context, linked_channels (context, id),
+                                out, n, 0);
+                  return_buffer (context, returnv, out, n);
+               }
             }
          }
-         break;
       }
       break;
+
+   case read_rmcios:
+      if (this == 0)
+         break;
+      return_int (context, returnv, this->error_offset);
+      break;
    }
 }
 
 //  
 
 const char *hex_encode = "0123456789ABCDEF";
+const char *hex_encode_lower = "0123456789abcdef";
+
+// Default size of the reusable hex encoder/decoder output buffer
+#define HEX_OUTPUT_SIZE 256
 
 struct hex_data
 {
    int datasize;
    char *data;
    int dataindex;
+   int nibble;                  // pending high nibble of decoder, -1=none
+   char latest;                 // latest decoded/encoded byte
+
+   // Encoder output formatting
+   const char *digits;
+   char separator;              // symbol between bytes, 0=none
+   char started;                // bytes already encoded since reset
+   char *out;                   // reusable output buffer
+   int outsize;
 };
 
+// Encode block of bytes to hex symbols.
+// Separator is placed between bytes when nonzero. *started tells if
+// the stream already has bytes, so the separator continues over blocks.
+// out needs room for len * 3 symbols. Returns the number of symbols.
+int hex_encode_block (const char *digits, char separator, char *started,
+                      const unsigned char *in, int len, char *out)
+{
+   char *o = out;
+   int i = 0;
+   if (separator == 0)
+   {
+      for (; i + 4 <= len; i += 4, o += 8)
+      {
+         unsigned char a = in[i], b = in[i + 1];
+         unsigned char c = in[i + 2], d = in[i + 3];
+         o[0] = digits[a >> 4];
+         o[1] = digits[a & 0x0F];
+         o[2] = digits[b >> 4];
+         o[3] = digits[b & 0x0F];
+         o[4] = digits[c >> 4];
+         o[5] = digits[c & 0x0F];
+         o[6] = digits[d >> 4];
+         o[7] = digits[d & 0x0F];
+      }
+      for (; i < len; i++, o += 2)
+      {
+         o[0] = digits[in[i] >> 4];
+         o[1] = digits[in[i] & 0x0F];
+      }
+   }
+   else
+   {
+      for (; i < len; i++)
+      {
+         if (*started)
+            *o++ = separator;
+         *o++ = digits[in[i] >> 4];
+         *o++ = digits[in[i] & 0x0F];
+         *started = 1;
+      }
+   }
+   if (len > 0)
+      *started = 1;
+   return o - out;
+}
+
 void hex_encoder_class_func (struct hex_data *this,
                              const struct context_rmcios *context, int id,
                              enum function_rmcios function,
@@ -383,8 +698,13 @@ void hex_encoder_class_func (struct hex_data *this,
       return_string (context, returnv,
                      "Hex encoder. Encodes binary to hex string\r\n"
                      "create hex_encoder newname\r\n"
-                     "setup newname bytes(0)\r\n"
+                     "setup newname bytes(0) | lowercase(0) | separator()"
+                     " | chunk_size(256)\r\n"
                      " -Set ammount bytes to encode. 0=continuous\r\n"
+                     " -lowercase: 1=use lowercase hex digits\r\n"
+                     " -separator: character between encoded bytes\r\n"
+                     " -chunk_size: max symbols in single write"
+                     " to linked channels\r\n"
                      "write \r\n"
                      " -Reset byte counter\r\n"
                      "write newname data\r\n"
@@ -392,6 +712,7 @@ void hex_encoder_class_func (struct hex_data *this,
                      " -returns the encoded string\r\n"
                      " -encoded data go to linked channels\r\n"
                      " -on continuous mode all hex data is sent to linked\r\n"
+                     "  once per write or chunk_size symbols\r\n"
                      " -otherwise only full set of hex data from n bytes\r\n"
                      "read newname\r\n"
                      " -Get latest hex data. \r\n"
@@ -412,6 +733,14 @@ void hex_encoder_class_func (struct hex_data *this,
       this->data = 0;
       this->datasize = 0;
       this->dataindex = 0;
+      this->latest = 0;
+      this->digits = hex_encode;
+      this->separator = 0;
+      this->started = 0;
+      this->outsize = HEX_OUTPUT_SIZE;
+      this->out = (char *) allocate_storage (context, this->outsize, 0);
+      if (this->out == 0)
+         this->outsize = 0;
       // create the channel
       create_channel_param (context, paramtype, param, 0, 
                             (class_rmcios) hex_encoder_class_func, this); 
@@ -421,49 +750,122 @@ void hex_encoder_class_func (struct hex_data *this,
          break;
       if (num_params < 1)
          break;
+      {
+         int bytes = param_to_int (context, paramtype, param, 0);
+         if (bytes < 0)
+            bytes = 0;
+         if (num_params >= 2)
+         {
+            if (param_to_int (context, paramtype, param, 1) == 1)
+               this->digits = hex_encode_lower;
+            else
+               this->digits = hex_encode;
+         }
+         if (num_params >= 3)
+         {
+            char separator = 0;
+            struct buffer_rmcios s;
+            s = param_to_buffer (context, paramtype, param, 2, 1,
+                                 &separator);
+            this->separator = (s.length > 0) ? s.data[0] : 0;
+         }
+         if (num_params >= 4)
+         {
+            int outsize = param_to_int (context, paramtype, param, 3);
+            // Room for at least one byte with separator
+            if (outsize < 3)
+               outsize = 3;
+            if (this->out != 0)
+               free_storage (context, this->out, 0);
+            this->outsize = outsize;
+            this->out = (char *) allocate_storage (context, outsize, 0);
+            if (this->out == 0)
+               this->outsize = 0;
+         }
 
-      this->datasize = param_to_int (context, paramtype, param, 0) * 2;
-      if (this->data != 0)
-         free_storage (context, this->data, 0);
-      this->data = allocate_storage (context, this->datasize, 0);
-      if (this->data == 0)
-         this->datasize = 0;
+         // Frame of n bytes as encoded symbols
+         this->datasize = bytes * 2;
+         if (this->separator != 0 && bytes > 0)
+            this->datasize += bytes - 1;
+         if (this->data != 0)
+            free_storage (context, this->data, 0);
+         this->data = 0;
+         if (this->datasize > 0)
+            this->data = allocate_storage (context, this->datasize, 0);
+         if (this->data == 0)
+            this->datasize = 0;
+         this->dataindex = 0;
+         this->started = 0;
+      }
       break;
 
    case write_rmcios:
-      if (num_params < 1 && this != 0)
+      if (num_params < 1)
       {
-         return_buffer (context, returnv, this->data,
-                        this->dataindex);
+         if (this == 0)
+            break;
+         if (this->data != 0)
+            return_buffer (context, returnv, this->data,
+                           this->dataindex);
          this->dataindex = 0;
+         this->started = 0;
          break;
       }
       int plen = param_binary_length (context, paramtype, param, 0);
       {
-         char buffer[plen * 2 + 1];
-         int i;
-         char *data = buffer + plen;
-         param_to_binary (context, paramtype, param, 0, plen, data);
-         for (i = 0; i < plen; i++)
-         {
-            char byte = data[i];
-            buffer[i << 1] = hex_encode[((byte >> 4) & 0x0F)];
-            buffer[(i << 1) + 1] = hex_encode[(byte & 0x0F)];
+         char buffer[plen];
+         char local[HEX_OUTPUT_SIZE];
+         const char *digits = hex_encode;
+         char separator = 0;
+         char started = 0;
+         char *out = local;
+         int outsize = sizeof (local);
+         struct buffer_rmcios p;
+         int i, step;
 
-            if (this != 0 && this->datasize == 0)
+         p = param_to_binary (context, paramtype, param, 0, plen, buffer);
+         if (this != 0)
+         {
+            digits = this->digits;
+            separator = this->separator;
+            started = this->started;
+            if (this->out != 0)
             {
-               write_buffer (context,
-                             linked_channels (context, id),
-                             buffer + (i << 1), 2, 0);
+               out = this->out;
+               outsize = this->outsize;
             }
+         }
 
-            if (this != 0 && this->dataindex < this->datasize - 1)
-            {
-               this->data[this->dataindex] = buffer[i << 1];
-               this->data[this->dataindex + 1] = buffer[(i << 1) + 1];
-               this->dataindex += 2;
+         // Encode in chunks that fit to the output buffer
+         step = outsize / (separator ? 3 : 2);
+         for (i = 0; i < p.length; i += step)
+         {
+            int n;
+            int count = p.length - i;
+            if (count > step)
+               count = step;
+            n = hex_encode_block (digits, separator, &started,
+                                  (const unsigned char *) p.data + i,
+                                  count, out);
+            return_buffer (context, returnv, out, n);
+            if (this == 0)
+               continue;
 
-               if (this->dataindex >= this->datasize - 1)
+            if (this->datasize == 0)
+            {
+               write_buffer (context, linked_channels (context, id),
+                             out, n, 0);
+            }
+            else if (this->dataindex < this->datasize)
+            {
+               int j;
+               if (n > this->datasize - this->dataindex)
+                  n = this->datasize - this->dataindex;
+               for (j = 0; j < n; j++)
+                  this->data[this->dataindex + j] = out[j];
+               this->dataindex += n;
+
+               if (this->dataindex >= this->datasize)
                {
                   write_buffer (context,
                                 linked_channels (context, id),
@@ -471,19 +873,117 @@ void hex_encoder_class_func (struct hex_data *this,
                }
             }
          }
-         buffer[plen * 2] = 0;
-         return_string (context, returnv, buffer);
+         if (this != 0)
+         {
+            this->started = started;
+            if (p.length > 0)
+               this->latest = p.data[p.length - 1];
+         }
       }
       break;
 
    case read_rmcios:
-      if (this == 0 || this->data==0 ) break;
-      return_buffer (context, returnv, this->data,
-                     this->dataindex + 1);
+      if (this == 0)
+         break;
+      if (this->data == 0)
+      {
+         char symbol[2];
+         symbol[0] = this->digits[(this->latest >> 4) & 0x0F];
+         symbol[1] = this->digits[this->latest & 0x0F];
+         return_buffer (context, returnv, symbol, 2);
+      }
+      else
+         return_buffer (context, returnv, this->data, this->dataindex);
       break;
    }
 }
 
+// Nibble values of hex symbols for the decoder.
+#define XX 0xFF                 // invalid symbol
+#define SP 0x40                 // whitespace, skipped
+static const unsigned char hex_decode_table[256] = {
+   XX, XX, XX, XX, XX, XX, XX, XX, XX, SP, SP, XX, XX, SP, XX, XX,
+   XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+   SP, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    0,  1,  2,  3,  4,  5,  6,  7,  8,  9, XX, XX, XX, XX, XX, XX,
+   XX, 10, 11, 12, 13, 14, 15, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+   XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+   XX, 10, 11, 12, 13, 14, 15, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+   XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+   XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+   XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+   XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+   XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+   XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+   XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+   XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+   XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX
+};
+#undef XX
+#undef SP
+
+// Decode block of hex symbols to bytes.
+// *nibble holds the odd high nibble left over from previous block
+// (-1 when none) and is updated for the next block.
+// Whitespace is skipped. Invalid symbols discard the pending nibble.
+// Returns the number of bytes written to out (at most (len + 1) / 2).
+int hex_decode_block (int *nibble, const unsigned char *in, int len,
+                      char *out)
+{
+   const unsigned char *t = hex_decode_table;
+   char *o = out;
+   int i = 0;
+
+   while (i < len)
+   {
+      if (*nibble < 0)
+      {
+         // Symbol pairs. Invalid and whitespace symbols have
+         // high bits set in the table and end the fast loop.
+         for (; i + 8 <= len; i += 8, o += 4)
+         {
+            unsigned char a = t[in[i]], b = t[in[i + 1]];
+            unsigned char c = t[in[i + 2]], d = t[in[i + 3]];
+            unsigned char e = t[in[i + 4]], f = t[in[i + 5]];
+            unsigned char g = t[in[i + 6]], h = t[in[i + 7]];
+            if ((a | b | c | d | e | f | g | h) & 0xF0)
+               break;
+            o[0] = a << 4 | b;
+            o[1] = c << 4 | d;
+            o[2] = e << 4 | f;
+            o[3] = g << 4 | h;
+         }
+         for (; i + 2 <= len; i += 2, o++)
+         {
+            unsigned char a = t[in[i]], b = t[in[i + 1]];
+            if ((a | b) & 0xF0)
+               break;
+            *o = a << 4 | b;
+         }
+         if (i >= len)
+            break;
+      }
+
+      // Single symbol
+      {
+         unsigned char value = t[in[i++]];
+         if (value < 0x10)
+         {
+            if (*nibble < 0)
+               *nibble = value;
+            else
+            {
+               *o++ = (*nibble) << 4 | value;
+               *nibble = -1;
+            }
+         }
+         else if (value != 0x40)
+            *nibble = -1;
+      }
+   }
+   return o - out;
+}
+
 void hex_decoder_class_func (struct hex_data *this,
                              const struct context_rmcios *context, int id,
                              enum function_rmcios function,
@@ -503,9 +1003,12 @@ void hex_decoder_class_func (struct hex_data *this,
                      " -Reset byte counter\r\n"
                      "write newname data\r\n"
                      " -feed string to be decoded\r\n"
+                     " -whitespace is skipped."
+                     " Odd nibble is kept for the next write.\r\n"
                      " -returns the decoded bytes\r\n"
                      " -decoded data go to linked channels\r\n"
-                     " -on continuous mode all decoded data is sent to linked.\r\n"
+                     " -on continuous mode all decoded data is sent to linked\r\n"
+                     "  in writes of up to 256 bytes\r\n"
                      " -otherwise only full set of decoded bytes\r\n"
                      "read newname\r\n"
                      " -Get latest binary data. \r\n"
@@ -526,44 +1029,110 @@ void hex_decoder_class_func (struct hex_data *this,
       this->data = 0 ;
       this->datasize = 0 ;
       this->dataindex = 0 ;
+      this->nibble = -1 ;
+      this->latest = 0 ;
+      this->outsize = HEX_OUTPUT_SIZE;
+      this->out = (char *) allocate_storage (context, this->outsize, 0);
+      if (this->out == 0)
+         this->outsize = 0;
       // create the channel
       create_channel_param (context, paramtype, param, 0, 
                            (class_rmcios) hex_decoder_class_func, this); 
       break;
 
+   case setup_rmcios:
+      if (this == 0)
+         break;
+      if (num_params < 1)
+         break;
+
+      this->datasize = param_to_int (context, paramtype, param, 0);
+      if (this->datasize < 0)
+         this->datasize = 0;
+      if (this->data != 0)
+         free_storage (context, this->data, 0);
+      this->data = 0;
+      if (this->datasize > 0)
+         this->data = allocate_storage (context, this->datasize, 0);
+      if (this->data == 0)
+         this->datasize = 0;
+      this->dataindex = 0;
+      this->nibble = -1;
+      break;
+
    case write_rmcios:
-      if (num_params < 1 && this != 0)
+      if (num_params < 1)
       {
-         return_buffer (context, returnv, this->data,
-                        this->dataindex);
+         if (this == 0)
+            break;
+         if (this->data != 0)
+            return_buffer (context, returnv, this->data,
+                           this->dataindex);
          this->dataindex = 0;
+         this->nibble = -1;
          break;
       }
-      int plen = param_buffer_length (context, paramtype, param, 0);
+      int plen = param_buffer_alloc_size (context, paramtype, param, 0);
       {
-         char buffer[plen + 1];
-         int i;
-         char *data = buffer + plen;
-         param_to_buffer (context, paramtype, param, 0, plen, data);
-         for (i = 0; i < plen; i++)
+         char buffer[paramtype == buffer_rmcios ? 1 : plen];
+         char local[HEX_OUTPUT_SIZE];
+         int direct_nibble = -1;
+         int *nibble = &direct_nibble;
+         char *out = local;
+         int outsize = sizeof (local);
+         struct buffer_rmcios buf;
+         int i, step;
+
+         if (paramtype == buffer_rmcios)
+            buf = param.bv[0];
+         else
+            buf = param_to_buffer (context, paramtype, param, 0, plen,
+                                   buffer);
+         if (this != 0)
+         {
+            nibble = &this->nibble;
+            if (this->out != 0)
+            {
+               out = this->out;
+               outsize = this->outsize;
+            }
+         }
+
+         // Decode in chunks that fit to the output buffer
+         step = outsize * 2;
+         for (i = 0; i < buf.length; i += step)
          {
-            char byte = data[i];
-            buffer[i << 1] = hex_encode[((byte >> 4) & 0x0F)];
+            int n;
+            int count = buf.length - i;
+            if (count > step)
+               count = step;
+            n = hex_decode_block (nibble,
+                                  (const unsigned char *) buf.data + i,
+                                  count, out);
+            return_buffer (context, returnv, out, n);
+            if (this == 0)
+               continue;
+            if (n > 0)
+               this->latest = out[n - 1];
 
             if (this->datasize == 0)
             {
-               write_buffer (context,
-                             linked_channels (context, id),
-                             buffer + (i << 1), 2, 0);
+               // Continuous mode. Send each decoded chunk.
+               if (n > 0)
+                  write_buffer (context, linked_channels (context, id),
+                                out, n, 0);
             }
-
-            if (this != 0 && this->dataindex < this->datasize - 1)
+            else if (this->dataindex < this->datasize)
             {
-               this->data[this->dataindex] = buffer[i << 1];
-               this->data[this->dataindex + 1] = buffer[(i << 1) + 1];
-               this->dataindex += 2;
-
-               if (this->dataindex >= this->datasize - 1)
+               // Collect full set of bytes
+               int j;
+               if (n > this->datasize - this->dataindex)
+                  n = this->datasize - this->dataindex;
+               for (j = 0; j < n; j++)
+                  this->data[this->dataindex + j] = out[j];
+               this->dataindex += n;
+
+               if (this->dataindex >= this->datasize)
                {
                   write_buffer (context,
                                 linked_channels (context, id),
@@ -571,15 +1140,16 @@ void hex_decoder_class_func (struct hex_data *this,
                }
             }
          }
-         buffer[plen] = 0;
-         return_string (context, returnv, buffer);
       }
       break;
 
    case read_rmcios:
-      if (this == 0 || this->data==0) break;
-      return_buffer (context, returnv, this->data,
-                     this->dataindex + 1);
+      if (this == 0)
+         break;
+      if (this->data == 0)
+         return_buffer (context, returnv, (char *) &this->latest, 1);
+      else
+         return_buffer (context, returnv, this->data, this->dataindex);
       break;
    }
 }
@@ -603,52 +1173,235 @@ struct binary_decoder_data
    int repetitions;
    int word_size;
    char endianess;
-   int *fields_bits;
+   int *fields_bits;            // bit widths of all fields. negative=signed
+   int num_fields;
+   char record_mode;            // 1=emit whole records at once
+   int *record_channels;        // per-field destination channels
+   int num_record_channels;
+
+   // Record being collected in record mode
+   int *record;
+   int record_size;
 
    // State registers
-   int bit_index;               // Bit offset within message
+   int bit_index;               // Bits available in input_register
    int field_index;             // index of field being retreived
-   int input_register;
+   unsigned long long input_register;
+   unsigned int word_register;  // Word being assembled from input bytes
+   int word_bytes;              // Bytes in word_register
+   int skip_bits;               // Bits left to skip before first field
+   int repetition_index;        // Completed field repetitions
    int latest_field;
 };
 
-void binary_decoder_class_func (struct binary_decoder_data *this,
-                                const struct context_rmcios *context, int id,
-                                enum function_rmcios function,
-                                enum type_rmcios paramtype,
-                                struct combo_rmcios *returnv,
-                                int num_params, const union param_rmcios param)
+// Reset binary decoder to the start of message
+static void binary_decoder_reset (struct binary_decoder_data *this)
 {
-   switch (function)
-   {
-   case help_rmcios:
-      return_string (context, returnv,
-            "binary decoder. decodes binary data from binary stream\r\n"
-            "create bin_dec newname\r\n"
-            "setup newname field1_bits(8) | start_offset(0) | repetitions(0)"
-            " | wordsize(8)"
-            "  -field1_bits: Bits in the payload value\r\n"
-            "  -start_offset: start bit offset of the decoding \r\n"
-            "  -repetitions: Ammount of field looping repetitions."
-            " 0=continuous\r\n"
-            "  -wordsize: size of atomic words in bits\r\n"
-            "  -endian: Ordering of words 0=Little-endian(LSB first), "
-            "1=Big-Endian(MSB first/Network order)\r\n"
-            "  -fields_bits: variable number of optional bitswidths for"
-            " fields that follow after the first one.\r\n"
-            "write newname\r\n"
-            "  -reset field & bit counter\r\n"
-            "write newname data\r\n"
-            "  -feed data to the decoder\r\n"
-            "read newname\r\n"
-            "  -read last decoded field\r\n"
-            "link newname channel\r\n"
-            "  -link converted values to channel\r\n"
-        );
-      break;
+   this->bit_index = 0;
+   this->field_index = 0;
+   this->input_register = 0;
+   this->word_register = 0;
+   this->word_bytes = 0;
+   this->skip_bits = this->start_offset;
+   this->repetition_index = 0;
+}
 
-   case create_rmcios:
-      if (num_params < 1)
+// Feed bytes to the binary decoder bit reader.
+// Input bytes are collected into words of word_size bits, that are
+// shifted to the 64 bit input register in configured byte order.
+// Big-endian words are read MSB first and little-endian words LSB first.
+// Calls field_func for each decoded field.
+// Returns the number of consumed bytes. Consumption stops after
+// the configured number of repetitions.
+static int binary_decoder_feed (struct binary_decoder_data *this,
+                                const unsigned char *data, int length,
+                                void (*field_func) (void *, int, int),
+                                void *field_data)
+{
+   int word_bytes = this->word_size >> 3;
+   int i;
+
+   for (i = 0; i < length; i++)
+   {
+      if (this->repetitions > 0
+          && this->repetition_index >= this->repetitions)
+         break;
+
+      // Assemble word
+      if (this->endianess == 1)
+         this->word_register = this->word_register << 8 | data[i];
+      else
+         this->word_register |= (unsigned int) data[i]
+                                << (this->word_bytes << 3);
+      if (++this->word_bytes < word_bytes)
+         continue;
+
+      // Shift complete word to the input register
+      if (this->endianess == 1)
+         this->input_register = this->input_register << this->word_size
+                                | this->word_register;
+      else
+         this->input_register |= (unsigned long long) this->word_register
+                                 << this->bit_index;
+      this->bit_index += this->word_size;
+      this->word_register = 0;
+      this->word_bytes = 0;
+
+      // Skip the start offset
+      if (this->skip_bits > 0)
+      {
+         int skip = this->skip_bits;
+         if (skip > this->bit_index)
+            skip = this->bit_index;
+         if (this->endianess != 1)
+            this->input_register >>= skip;
+         this->bit_index -= skip;
+         this->skip_bits -= skip;
+      }
+
+      // Extract the available fields
+      for (;;)
+      {
+         int bits = this->fields_bits[this->field_index];
+         int width = (bits < 0) ? -bits : bits;
+         unsigned int value;
+
+         if (this->bit_index < width)
+            break;
+
+         if (this->endianess == 1)
+            value = (unsigned int) (this->input_register
+                                    >> (this->bit_index - width))
+                    & bitmask[width];
+         else
+         {
+            value = (unsigned int) this->input_register & bitmask[width];
+            this->input_register >>= width;
+         }
+         this->bit_index -= width;
+
+         // Two's complement sign extension
+         if (bits < 0 && (value >> (width - 1)) & 1)
+            value |= ~bitmask[width];
+
+         this->latest_field = (int) value;
+         field_func (field_data, this->field_index, this->latest_field);
+
+         if (++this->field_index >= this->num_fields)
+         {
+            this->field_index = 0;
+            this->repetition_index++;
+            if (this->repetitions > 0
+                && this->repetition_index >= this->repetitions)
+               break;
+         }
+      }
+   }
+   return i;
+}
+
+// Allocate record vector for the configured fields
+static void binary_decoder_alloc_record (const struct context_rmcios *context,
+                                         struct binary_decoder_data *this)
+{
+   if (this->record_mode == 0 || this->record_size == this->num_fields)
+      return;
+   if (this->record != 0)
+      free_storage (context, this->record, 0);
+   this->record = (int *) allocate_storage (context,
+                                            this->num_fields * sizeof (int),
+                                            0);
+   this->record_size = (this->record != 0) ? this->num_fields : 0;
+   if (this->record == 0)
+      this->record_mode = 0;
+}
+
+struct binary_decoder_output
+{
+   const struct context_rmcios *context;
+   struct binary_decoder_data *this;
+   int linked;
+};
+
+static void binary_decoder_write_field (void *data, int index, int value)
+{
+   struct binary_decoder_output *output = data;
+   write_i (output->context, output->linked, value);
+}
+
+// Collect field to record and emit the record when complete
+static void binary_decoder_record_field (void *data, int index, int value)
+{
+   struct binary_decoder_output *output = data;
+   struct binary_decoder_data *this = output->this;
+   int i;
+
+   this->record[index] = value;
+   if (index < this->num_fields - 1)
+      return;
+
+   if (this->num_record_channels == 0)
+   {
+      // Whole record as single multi-parameter write
+      write_iv (output->context, output->linked,
+                this->num_fields, this->record);
+      return;
+   }
+   for (i = 0; i < this->num_fields && i < this->num_record_channels; i++)
+   {
+      if (this->record_channels[i] != 0)
+         write_i (output->context, this->record_channels[i],
+                  this->record[i]);
+   }
+}
+
+void binary_decoder_class_func (struct binary_decoder_data *this,
+                                const struct context_rmcios *context, int id,
+                                enum function_rmcios function,
+                                enum type_rmcios paramtype,
+                                struct combo_rmcios *returnv,
+                                int num_params, const union param_rmcios param)
+{
+   switch (function)
+   {
+   case help_rmcios:
+      return_string (context, returnv,
+            "binary decoder. decodes binary data from binary stream\r\n"
+            "create bin_dec newname\r\n"
+            "setup newname field1_bits(8) | start_offset(0) | repetitions(0)"
+            " | wordsize(8) | endian(1) | field2_bits field3_bits...\r\n"
+            "  -field1_bits: Bits in the payload value."
+            " Negative for signed (two's complement) field. max 32.\r\n"
+            "  -start_offset: start bit offset of the decoding \r\n"
+            "  -repetitions: Ammount of field looping repetitions."
+            " 0=continuous\r\n"
+            "  -wordsize: size of atomic words in bits (8,16,24 or 32)\r\n"
+            "  -endian: Ordering of words 0=Little-endian(LSB first), "
+            "1=Big-Endian(MSB first/Network order)\r\n"
+            "  -fields_bits: variable number of optional bitswidths for"
+            " fields that follow after the first one.\r\n"
+            "setup newname record | field1_channel field2_channel...\r\n"
+            "  -Collect fields of each repetition to record."
+            " Complete record is written to linked channels as"
+            " single write with all fields as parameters.\r\n"
+            "  -When field channels are given each field of the record"
+            " is written to its own channel instead. (0=skip field)\r\n"
+            "setup newname stream\r\n"
+            "  -Write each field to linked channels separately. (default)\r\n"
+            "write newname\r\n"
+            "  -reset field & bit counter\r\n"
+            "write newname data\r\n"
+            "  -feed data to the decoder\r\n"
+            "  -fields may span over multiple writes\r\n"
+            "read newname\r\n"
+            "  -read last decoded field\r\n"
+            "link newname channel\r\n"
+            "  -link converted values to channel\r\n"
+        );
+      break;
+
+   case create_rmcios:
+      if (num_params < 1)
          break;
       else
       {
@@ -663,15 +1416,19 @@ void binary_decoder_class_func (struct binary_decoder_data *this,
       this->field1_bits = 8;
       this->start_offset = 0;
       this->repetitions = 0;
-      this->word_size = 0;
+      this->word_size = 8;
       this->endianess = 1;
-      this->fields_bits = 0;
+      this->fields_bits = &this->field1_bits;
+      this->num_fields = 1;
+      this->record_mode = 0;
+      this->record_channels = 0;
+      this->num_record_channels = 0;
+      this->record = 0;
+      this->record_size = 0;
 
       // State registers
-      this->bit_index = 0;      // Bit offset within message
-      this->field_index = 0;    // index of field being retreived
       this->latest_field = 0;
-      this->input_register = 0;
+      binary_decoder_reset (this);
 
       // create the channel
       create_channel_param (context, paramtype, param, 0, 
@@ -684,63 +1441,122 @@ void binary_decoder_class_func (struct binary_decoder_data *this,
       // Configuration registers
       if (num_params < 1)
          break;
+      {
+         // Output mode selection
+         char mode[8];
+         const char *s;
+         s = param_to_string (context, paramtype, param, 0,
+                              sizeof (mode), mode);
+         if (strcmp (s, "stream") == 0)
+         {
+            this->record_mode = 0;
+            break;
+         }
+         if (strcmp (s, "record") == 0)
+         {
+            int i;
+            if (this->record_channels != 0)
+               free_storage (context, this->record_channels, 0);
+            this->record_channels = 0;
+            this->num_record_channels = 0;
+            if (num_params > 1)
+               this->record_channels =
+                  (int *) allocate_storage (context,
+                                            (num_params - 1) * sizeof (int),
+                                            0);
+            if (this->record_channels != 0)
+            {
+               this->num_record_channels = num_params - 1;
+               for (i = 1; i < num_params; i++)
+                  this->record_channels[i - 1] =
+                     param_to_int (context, paramtype, param, i);
+            }
+            this->record_mode = 1;
+            binary_decoder_alloc_record (context, this);
+            binary_decoder_reset (this);
+            break;
+         }
+      }
+      if (this->fields_bits != &this->field1_bits)
+         free_storage (context, this->fields_bits, 0);
+      this->fields_bits = &this->field1_bits;
+      this->num_fields = 1;
+
       this->field1_bits = param_to_integer (context, paramtype, param, 0);
-      if (num_params < 2)
-         break;
-      this->start_offset = param_to_integer (context, paramtype, param, 1);
-      if (num_params < 3)
-         break;
-      this->repetitions = param_to_integer (context, paramtype, param, 2);
-      if (num_params < 4)
-         break;
-      this->word_size = param_to_integer (context, paramtype, param, 3);
-      if (num_params < 5)
-         break;
-      this->endianess = param_to_integer (context, paramtype, param, 4);
-      //if(num_params<6) break ;
-      //this->fields_bits=param_to_integer(paramtype,param,5)
+      if (num_params >= 2)
+         this->start_offset = param_to_integer (context, paramtype, param, 1);
+      if (num_params >= 3)
+         this->repetitions = param_to_integer (context, paramtype, param, 2);
+      if (num_params >= 4)
+         this->word_size = param_to_integer (context, paramtype, param, 3);
+      if (num_params >= 5)
+         this->endianess = param_to_integer (context, paramtype, param, 4);
+      if (num_params >= 6)
+      {
+         int *fields_bits;
+         int i;
+         fields_bits = (int *) allocate_storage (context,
+                                                 (num_params - 4)
+                                                 * sizeof (int), 0);
+         if (fields_bits != 0)
+         {
+            fields_bits[0] = this->field1_bits;
+            for (i = 5; i < num_params; i++)
+               fields_bits[i - 4] =
+                  param_to_integer (context, paramtype, param, i);
+            this->fields_bits = fields_bits;
+            this->num_fields = num_params - 4;
+         }
+      }
+
+      // Limit to supported sizes
+      {
+         int i;
+         for (i = 0; i < this->num_fields; i++)
+         {
+            if (this->fields_bits[i] > 32)
+               this->fields_bits[i] = 32;
+            if (this->fields_bits[i] < -32)
+               this->fields_bits[i] = -32;
+            if (this->fields_bits[i] == 0)
+               this->fields_bits[i] = 8;
+         }
+      }
+      if (this->word_size < 8 || this->word_size > 32)
+         this->word_size = 8;
+      this->word_size &= ~7;
+      if (this->start_offset < 0)
+         this->start_offset = 0;
+      binary_decoder_alloc_record (context, this);
+      binary_decoder_reset (this);
       break;
+
    case write_rmcios:
       if (this == 0)
          break;
       if (num_params == 0)
       {
-         this->bit_index = 0;
-         this->field_index = 0;
+         binary_decoder_reset (this);
          break;
       }
       else
       {
          int blen;
-         int i;
          struct buffer_rmcios p;
          blen = param_binary_length (context, paramtype, param, 0);
          {
             char buffer[blen];
+            struct binary_decoder_output output = {
+               .context = context,
+               .this = this,
+               .linked = linked_channels (context, id)
+            };
             p = param_to_binary (context, paramtype, param, 0, blen, buffer);
-            for (i = 0; i < p.length; i++)
-            {
-               if (this->endianess == 1)        // Big endian
-               {
-                  // Big endian
-                  this->input_register = this->input_register << 8 | p.data[i];
-                  this->bit_index += 8;
-
-                  while (this->bit_index >= this->field1_bits)
-                  {
-                     this->latest_field =
-                        this->input_register >> (this->
-                                                 bit_index -
-                                                 this->
-                                                 field1_bits)
-                        & bitmask[this->field1_bits];
-                     this->bit_index = this->bit_index - this->field1_bits;
-                     write_i (context,
-                              linked_channels (context, id),
-                              this->latest_field);
-                  }
-               }
-            }
+            binary_decoder_feed (this, (const unsigned char *) p.data,
+                                 p.length,
+                                 this->record_mode ?
+                                 binary_decoder_record_field :
+                                 binary_decoder_write_field, &output);
          }
       }
       break;
@@ -764,12 +1580,80 @@ struct binary_encoder_data
    int *fields_bits;
 
    // State registers
-   int bit_index;
+   int bit_index;               // Bits in out_register
    int field_index;             // index of field being sent
-   int out_register;
+   unsigned long long out_register;
    int latest_word;
+
+   // Encoded frame waiting to be sent
+   char *frame;
+   int frame_size;
+   int frame_length;
 };
 
+// Send the encoded frame to linked channels as single write
+static void binary_encoder_flush (const struct context_rmcios *context,
+                                  int id, struct binary_encoder_data *this)
+{
+   if (this->frame_length > 0)
+      write_buffer (context, linked_channels (context, id),
+                    this->frame, this->frame_length, 0);
+   this->frame_length = 0;
+}
+
+// Move complete words from out register to the frame buffer.
+// Words are stored in configured byte order.
+static void binary_encoder_words (const struct context_rmcios *context,
+                                  int id, struct binary_encoder_data *this)
+{
+   int word_bytes = this->word_size >> 3;
+   while (this->bit_index >= this->word_size)
+   {
+      unsigned int word;
+      char *o;
+      int i;
+
+      if (this->endianess == 1)
+         word = (unsigned int) (this->out_register
+                                >> (this->bit_index - this->word_size))
+                & bitmask[this->word_size];
+      else
+      {
+         word = (unsigned int) this->out_register & bitmask[this->word_size];
+         this->out_register >>= this->word_size;
+      }
+      this->bit_index -= this->word_size;
+      this->latest_word = word;
+
+      if (this->frame_length + word_bytes > this->frame_size)
+         binary_encoder_flush (context, id, this);
+      if (word_bytes > this->frame_size)
+      {
+         // No frame buffer. Send the word directly.
+         char direct[4];
+         for (i = 0; i < word_bytes; i++)
+            direct[i] = word >> (((this->endianess == 1) ?
+                                  word_bytes - 1 - i : i) << 3);
+         write_buffer (context, linked_channels (context, id),
+                       direct, word_bytes, 0);
+         continue;
+      }
+
+      o = this->frame + this->frame_length;
+      if (this->endianess == 1)
+      {
+         for (i = word_bytes - 1; i >= 0; i--)
+            *o++ = word >> (i << 3);
+      }
+      else
+      {
+         for (i = 0; i < word_bytes; i++)
+            *o++ = word >> (i << 3);
+      }
+      this->frame_length += word_bytes;
+   }
+}
+
 void binary_encoder_class_func (struct binary_encoder_data *this,
                                 const struct context_rmcios *context, int id,
                                 enum function_rmcios function,
@@ -785,9 +1669,20 @@ void binary_encoder_class_func (struct binary_encoder_data *this,
                      "create bin_enc newname\r\n"
                      "setup newname field1_bits(8) | wordsize(8) | endian(1)"
                      " | field2_bits field3_bits...\r\n"
+                     "  -field bits: width of each field. max 32\r\n"
+                     "  -wordsize: size of atomic words in bits"
+                     " (8,16,24 or 32)\r\n"
+                     "  -endian: Ordering of words 0=Little-endian(LSB first), "
+                     "1=Big-Endian(MSB first/Network order)\r\n"
                      "write newname\r\n"
-                     "write newname value\r\n"
-                     "  -write value to data stream\r\n"
+                     "  -pad last word with zeros,"
+                     " send the frame and reset\r\n"
+                     "write newname value | value2 ...\r\n"
+                     "  -write values to data stream\r\n"
+                     "  -words are collected to frame that is sent"
+                     " after the last field as single write\r\n"
+                     "read newname\r\n"
+                     "  -latest encoded word\r\n"
                      "link newname channel\r\n"
                      "  -link encoded data to channel\r\n");
       break;
@@ -807,14 +1702,19 @@ void binary_encoder_class_func (struct binary_encoder_data *this,
       this->field1_bits = 8;
       this->word_size = 8;
       this->endianess = 1;
-      this->num_fields = 0;
-      this->fields_bits = 0;
+      this->num_fields = 1;
+      this->fields_bits = &this->field1_bits;
 
       // State registers
       this->bit_index = 0;
       this->field_index = 0;    // index of field being retreived
       this->latest_word = 0;
       this->out_register = 0;
+      this->frame_length = 0;
+      this->frame_size = 8;
+      this->frame = (char *) allocate_storage (context, this->frame_size, 0);
+      if (this->frame == 0)
+         this->frame_size = 0;
 
       // Create the channel
       create_channel_param (context, paramtype, param, 0,
@@ -827,13 +1727,63 @@ void binary_encoder_class_func (struct binary_encoder_data *this,
       // Configuration registers
       if (num_params < 1)
          break;
+      if (this->fields_bits != &this->field1_bits)
+         free_storage (context, this->fields_bits, 0);
+      this->fields_bits = &this->field1_bits;
+      this->num_fields = 1;
+
       this->field1_bits = param_to_integer (context, paramtype, param, 0);
-      if (num_params < 2)
-         break;
-      this->word_size = param_to_integer (context, paramtype, param, 1);
-      if (num_params < 3)
-         break;
-      this->endianess = param_to_integer (context, paramtype, param, 2);
+      if (num_params >= 2)
+         this->word_size = param_to_integer (context, paramtype, param, 1);
+      if (num_params >= 3)
+         this->endianess = param_to_integer (context, paramtype, param, 2);
+      if (num_params >= 4)
+      {
+         int *fields_bits;
+         int i;
+         fields_bits = (int *) allocate_storage (context,
+                                                 (num_params - 2)
+                                                 * sizeof (int), 0);
+         if (fields_bits != 0)
+         {
+            fields_bits[0] = this->field1_bits;
+            for (i = 3; i < num_params; i++)
+               fields_bits[i - 2] =
+                  param_to_integer (context, paramtype, param, i);
+            this->fields_bits = fields_bits;
+            this->num_fields = num_params - 2;
+         }
+      }
+      if (this->word_size < 8 || this->word_size > 32)
+         this->word_size = 8;
+      this->word_size &= ~7;
+
+      // Limit to supported sizes and allocate frame for all fields
+      {
+         int i;
+         int frame_bits = this->word_size;
+         for (i = 0; i < this->num_fields; i++)
+         {
+            if (this->fields_bits[i] < 0)
+               this->fields_bits[i] = -this->fields_bits[i];
+            if (this->fields_bits[i] > 32)
+               this->fields_bits[i] = 32;
+            if (this->fields_bits[i] == 0)
+               this->fields_bits[i] = 8;
+            frame_bits += this->fields_bits[i];
+         }
+         if (this->frame != 0)
+            free_storage (context, this->frame, 0);
+         this->frame_size = (frame_bits >> 3) + (this->word_size >> 3);
+         this->frame = (char *) allocate_storage (context,
+                                                  this->frame_size, 0);
+         if (this->frame == 0)
+            this->frame_size = 0;
+      }
+      this->bit_index = 0;
+      this->field_index = 0;
+      this->out_register = 0;
+      this->frame_length = 0;
       break;
 
    case write_rmcios:
@@ -841,35 +1791,43 @@ void binary_encoder_class_func (struct binary_encoder_data *this,
          break;
       if (num_params == 0)
       {
+         // Pad the last word and flush
+         if (this->bit_index > 0)
+         {
+            int pad = this->word_size - this->bit_index;
+            if (this->endianess == 1)
+               this->out_register <<= pad;
+            this->bit_index = this->word_size;
+            binary_encoder_words (context, id, this);
+         }
+         binary_encoder_flush (context, id, this);
          this->bit_index = 0;
          this->field_index = 0;
          this->out_register = 0;
       }
       else
       {
-         int i, value;
+         int i;
+         unsigned int value;
          for (i = 0; i < num_params; i++)
          {
-            value = param_to_integer (context, paramtype, param, i);
+            int width = this->fields_bits[this->field_index];
+            value = param_to_integer (context, paramtype, param, i)
+                    & bitmask[width];
 
-            // Big endian :
             if (this->endianess == 1)
+               this->out_register = (this->out_register << width) | value;
+            else
+               this->out_register |= (unsigned long long) value
+                                     << this->bit_index;
+            this->bit_index += width;
+            binary_encoder_words (context, id, this);
+
+            // Send the frame after last field
+            if (++this->field_index >= this->num_fields)
             {
-               this->out_register =
-                  (this->out_register << this->
-                   field1_bits) | (value & bitmask[this->field1_bits]);
-               this->bit_index += this->field1_bits;
-               while (this->bit_index >= this->word_size)
-               {
-                  this->latest_word =
-                     this->out_register >> (this->bit_index - this->word_size);
-                  this->bit_index -= this->word_size;
-                  this->out_register &= bitmask[this->bit_index];
-                  write_buffer (context,
-                                linked_channels (context, id),
-                                (char *) &this->latest_word,
-                                this->word_size >> 3, 0);
-               }
+               this->field_index = 0;
+               binary_encoder_flush (context, id, this);
             }
          }
       }
@@ -883,6 +1841,1347 @@ void binary_encoder_class_func (struct binary_encoder_data *this,
    }
 }
 
+//////////////////////////////////////////////////////////////////////////
+// Varint channels. LEB128 variable length integers with zigzag signing.
+//////////////////////////////////////////////////////////////////////////
+struct varint_data
+{
+   // Configuration
+   char zigzag;                 // 1=signed values with zigzag encoding
+   float scale;                 // value multiplier before encoding
+
+   // Decoder state
+   unsigned int value;          // bits of partially received value
+   int shift;
+   int latest;
+};
+
+// Maximum bytes of a 32 bit varint
+#define VARINT_MAX_BYTES 5
+
+// Encode values to varints. Returns the number of bytes written to out.
+// out needs room for count * VARINT_MAX_BYTES bytes.
+int varint_encode_block (const unsigned int *values, int count, char zigzag,
+                         char *out)
+{
+   char *o = out;
+   int i;
+   for (i = 0; i < count; i++)
+   {
+      unsigned int v = values[i];
+      if (zigzag)
+         v = (v << 1) ^ (unsigned int) ((int) v >> 31);
+      // Most values fit to one byte
+      while (v >= 0x80)
+      {
+         *o++ = (char) (v | 0x80);
+         v >>= 7;
+      }
+      *o++ = (char) v;
+   }
+   return o - out;
+}
+
+// Decode varints. Partially received value is kept in *value and *shift.
+// Returns the number of values written to values.
+int varint_decode_block (unsigned int *value, int *shift, char zigzag,
+                         const unsigned char *in, int len, int *values)
+{
+   int n = 0;
+   int i = 0;
+   while (i < len)
+   {
+      // Single byte values without partial state
+      if (*shift == 0)
+      {
+         while (i < len && in[i] < 0x80)
+         {
+            unsigned int v = in[i++];
+            values[n++] = zigzag ? (int) ((v >> 1) ^ -(v & 1)) : (int) v;
+         }
+         if (i >= len)
+            break;
+      }
+
+      if (*shift < 32)
+         *value |= (unsigned int) (in[i] & 0x7F) << *shift;
+      *shift += 7;
+      if ((in[i++] & 0x80) == 0)
+      {
+         unsigned int v = *value;
+         values[n++] = zigzag ? (int) ((v >> 1) ^ -(v & 1)) : (int) v;
+         *value = 0;
+         *shift = 0;
+      }
+   }
+   return n;
+}
+
+void varint_encoder_class_func (struct varint_data *this,
+                                const struct context_rmcios *context, int id,
+                                enum function_rmcios function,
+                                enum type_rmcios paramtype,
+                                struct combo_rmcios *returnv,
+                                int num_params, const union param_rmcios param)
+{
+   switch (function)
+   {
+   case help_rmcios:
+      return_string (context, returnv,
+                     "varint encoder. Encodes numbers to"
+                     " variable length LEB128 integers\r\n"
+                     "create varint_enc newname\r\n"
+                     "setup newname signed(1) | scale(1)\r\n"
+                     "  -signed: 1=zigzag encode signed values."
+                     " 0=unsigned\r\n"
+                     "  -scale: multiplier of values before rounding"
+                     " to integer\r\n"
+                     "write newname value | value2 ...\r\n"
+                     "  -encode values."
+                     " All values are sent to linked channels as single write\r\n"
+                     "link newname channel\r\n");
+      break;
+
+   case create_rmcios:
+      if (num_params < 1)
+         break;
+      this = (struct varint_data *)
+             allocate_storage (context, sizeof (struct varint_data), 0);
+      if (this == 0)
+         break;
+      this->zigzag = 1;
+      this->scale = 1;
+      this->value = 0;
+      this->shift = 0;
+      this->latest = 0;
+      create_channel_param (context, paramtype, param, 0,
+                            (class_rmcios) varint_encoder_class_func, this);
+      break;
+
+   case setup_rmcios:
+      if (this == 0)
+         break;
+      if (num_params < 1)
+         break;
+      this->zigzag = (param_to_int (context, paramtype, param, 0) != 0);
+      if (num_params < 2)
+         break;
+      this->scale = param_to_float (context, paramtype, param, 1);
+      break;
+
+   case write_rmcios:
+      if (num_params < 1)
+         break;
+      {
+         unsigned int values[num_params];
+         char encoded[num_params * VARINT_MAX_BYTES];
+         char zigzag = 1;
+         float scale = 1;
+         int i, n;
+
+         if (this != 0)
+         {
+            zigzag = this->zigzag;
+            scale = this->scale;
+         }
+         for (i = 0; i < num_params; i++)
+         {
+            if (scale == 1)
+               values[i] = param_to_int (context, paramtype, param, i);
+            else
+            {
+               float v = param_to_float (context, paramtype, param, i)
+                         * scale;
+               values[i] = (int) (v < 0 ? v - 0.5f : v + 0.5f);
+            }
+         }
+         n = varint_encode_block (values, num_params, zigzag, encoded);
+         return_buffer (context, returnv, encoded, n);
+         if (this != 0)
+            write_buffer (context, linked_channels (context, id),
+                          encoded, n, 0);
+      }
+      break;
+   }
+}
+
+void varint_decoder_class_func (struct varint_data *this,
+                                const struct context_rmcios *context, int id,
+                                enum function_rmcios function,
+                                enum type_rmcios paramtype,
+                                struct combo_rmcios *returnv,
+                                int num_params, const union param_rmcios param)
+{
+   switch (function)
+   {
+   case help_rmcios:
+      return_string (context, returnv,
+                     "varint decoder. Decodes variable length LEB128"
+                     " integers from binary stream\r\n"
+                     "create varint_dec newname\r\n"
+                     "setup newname signed(1) | scale(1)\r\n"
+                     "  -signed: 1=zigzag encoded signed values."
+                     " 0=unsigned\r\n"
+                     "  -scale: decoded values are divided by scale\r\n"
+                     "write newname data\r\n"
+                     "  -decode data. Values may span over writes.\r\n"
+                     "  -values decoded from the data are sent to"
+                     " linked channels as single write\r\n"
+                     "write newname\r\n"
+                     "  -reset the decoder\r\n"
+                     "read newname\r\n"
+                     "  -latest decoded value\r\n"
+                     "link newname channel\r\n");
+      break;
+
+   case create_rmcios:
+      if (num_params < 1)
+         break;
+      this = (struct varint_data *)
+             allocate_storage (context, sizeof (struct varint_data), 0);
+      if (this == 0)
+         break;
+      this->zigzag = 1;
+      this->scale = 1;
+      this->value = 0;
+      this->shift = 0;
+      this->latest = 0;
+      create_channel_param (context, paramtype, param, 0,
+                            (class_rmcios) varint_decoder_class_func, this);
+      break;
+
+   case setup_rmcios:
+      if (this == 0)
+         break;
+      if (num_params < 1)
+         break;
+      this->zigzag = (param_to_int (context, paramtype, param, 0) != 0);
+      this->value = 0;
+      this->shift = 0;
+      if (num_params < 2)
+         break;
+      this->scale = param_to_float (context, paramtype, param, 1);
+      if (this->scale == 0)
+         this->scale = 1;
+      break;
+
+   case write_rmcios:
+      if (this == 0)
+         break;
+      if (num_params < 1)
+      {
+         this->value = 0;
+         this->shift = 0;
+         break;
+      }
+      {
+         int blen = param_binary_length (context, paramtype, param, 0);
+         char buffer[blen];
+         struct buffer_rmcios p;
+         int n;
+
+         p = param_to_binary (context, paramtype, param, 0, blen, buffer);
+         {
+            int values[p.length + 1];
+            n = varint_decode_block (&this->value, &this->shift,
+                                     this->zigzag,
+                                     (const unsigned char *) p.data,
+                                     p.length, values);
+            if (n == 0)
+               break;
+            this->latest = values[n - 1];
+            if (this->scale == 1)
+               write_iv (context, linked_channels (context, id), n, values);
+            else
+            {
+               float scaled[n];
+               int i;
+               for (i = 0; i < n; i++)
+                  scaled[i] = values[i] / this->scale;
+               write_fv (context, linked_channels (context, id), n, scaled);
+            }
+         }
+      }
+      break;
+
+   case read_rmcios:
+      if (this == 0)
+         break;
+      if (this->scale == 1)
+         return_int (context, returnv, this->latest);
+      else
+         return_float (context, returnv, this->latest / this->scale);
+      break;
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Frame codec channel. Frame layout is compiled at setup to table of
+// field extraction operations.
+//////////////////////////////////////////////////////////////////////////
+enum frame_field_type
+{
+   FRAME_PAD = 0,
+   FRAME_UINT,
+   FRAME_INT,
+   FRAME_HALF,
+   FRAME_FLOAT,
+   FRAME_DOUBLE
+};
+
+struct frame_field
+{
+   unsigned char type;          // enum frame_field_type
+   unsigned char bits;          // field width
+   unsigned char little_endian;
+   unsigned char byte_aligned;  // whole bytes at byte boundary
+   int byte_offset;             // first byte of the field in frame
+   unsigned char nbytes;        // bytes covering the field
+   unsigned char rshift;        // shift to align unaligned field
+   unsigned long long mask;
+   int channel;                 // destination channel, 0=none
+};
+
+// Integer fields are handled as int, float fields as float
+union frame_value
+{
+   int i;
+   float f;
+};
+
+static int frame_is_integer (const struct frame_field *f)
+{
+   return f->type == FRAME_UINT || f->type == FRAME_INT;
+}
+
+struct frame_codec_data
+{
+   struct frame_field *fields;
+   int num_fields;
+   int num_values;              // fields excluding padding
+   char integers;               // all values are integers
+   union frame_value *values;   // latest decoded values
+   char *frame;                 // frame being received
+   int frame_size;
+   int frame_length;
+};
+
+// Parse unsigned decimal number. Returns pointer after the number.
+static const char *frame_parse_number (const char *s, int *value)
+{
+   *value = 0;
+   while (*s >= '0' && *s <= '9')
+      *value = *value * 10 + (*s++ - '0');
+   return s;
+}
+
+// Compare prefix of s to word. Returns pointer after prefix or 0.
+static const char *frame_match (const char *s, const char *word)
+{
+   while (*word != 0)
+   {
+      if (*s++ != *word++)
+         return 0;
+   }
+   return s;
+}
+
+// Parse field type specifier: [be|le][u|i|f]N, bitsN, ibitsN or padN.
+// Returns 1 on success, 0 when s is not a type and -1 for integer
+// fields wider than int.
+static int frame_parse_type (const char *s, struct frame_field *field)
+{
+   const char *p;
+   int bits = 0;
+
+   field->little_endian = 0;
+   field->type = FRAME_UINT;
+   if ((p = frame_match (s, "ibits")) != 0)
+      field->type = FRAME_INT;
+   else if ((p = frame_match (s, "bits")) != 0)
+      field->type = FRAME_UINT;
+   else if ((p = frame_match (s, "pad")) != 0)
+      field->type = FRAME_PAD;
+   else
+   {
+      p = s;
+      if (frame_match (p, "be") != 0)
+         p += 2;
+      else if (frame_match (p, "le") != 0)
+      {
+         field->little_endian = 1;
+         p += 2;
+      }
+      if (*p == 'u')
+         p++;
+      else if (*p == 'i')
+      {
+         field->type = FRAME_INT;
+         p++;
+      }
+      else if (*p == 'f')
+      {
+         field->type = FRAME_FLOAT;
+         p++;
+      }
+      // Only whole bytes without bits prefix
+      if (*p < '0' || *p > '9')
+         return 0;
+      p = frame_parse_number (p, &bits);
+      if (*p != 0 || (bits & 7) != 0)
+         return 0;
+   }
+   if (bits == 0)
+   {
+      if (*p < '0' || *p > '9')
+         return 0;
+      p = frame_parse_number (p, &bits);
+      if (*p != 0)
+         return 0;
+   }
+
+   if (field->type == FRAME_FLOAT)
+   {
+      switch (bits)
+      {
+      case 16:
+         field->type = FRAME_HALF;
+         break;
+      case 32:
+         break;
+      case 64:
+         field->type = FRAME_DOUBLE;
+         break;
+      default:
+         return 0;
+      }
+   }
+   if (bits < 1 || bits > 64)
+      return 0;
+   // Integer values are passed as int
+   if ((field->type == FRAME_UINT || field->type == FRAME_INT) && bits > 32)
+      return -1;
+   field->bits = bits;
+   return 1;
+}
+
+// Compute byte offsets, shifts and masks of fields. Returns frame
+// size or -1 when a field is not supported at its position.
+static int frame_compile (struct frame_field *fields, int num_fields)
+{
+   int bit_offset = 0;
+   int i;
+   for (i = 0; i < num_fields; i++)
+   {
+      struct frame_field *f = fields + i;
+      int shift = bit_offset & 7;
+      // Unaligned fields need to fit to the 64 bit register
+      if (shift + f->bits > 64)
+         return -1;
+      f->byte_offset = bit_offset >> 3;
+      f->byte_aligned = (shift == 0 && (f->bits & 7) == 0);
+      // Little endian fields must start at byte boundary
+      if (f->little_endian && !f->byte_aligned)
+         return -1;
+      f->nbytes = (shift + f->bits + 7) >> 3;
+      f->rshift = (f->nbytes << 3) - shift - f->bits;
+      f->mask = (f->bits == 64) ? ~0ULL : ((1ULL << f->bits) - 1);
+      bit_offset += f->bits;
+   }
+   return (bit_offset + 7) >> 3;
+}
+
+// Half precision float to float conversion
+static float frame_half_to_float (unsigned int h)
+{
+   union
+   {
+      unsigned int u;
+      float f;
+   } v;
+   unsigned int sign = (h & 0x8000) << 16;
+   unsigned int exponent = (h >> 10) & 0x1F;
+   unsigned int mantissa = h & 0x3FF;
+
+   if (exponent == 0)
+   {
+      // Zero and subnormals
+      v.f = mantissa * (1.0f / 16777216.0f);
+      v.u |= sign;
+      return v.f;
+   }
+   if (exponent == 31)
+      v.u = sign | 0x7F800000 | (mantissa << 13);
+   else
+      v.u = sign | ((exponent + 112) << 23) | (mantissa << 13);
+   return v.f;
+}
+
+// Float to half precision float conversion (round to nearest)
+static unsigned int frame_float_to_half (float value)
+{
+   union
+   {
+      unsigned int u;
+      float f;
+   } v;
+   unsigned int sign;
+   int exponent;
+   unsigned int mantissa;
+
+   v.f = value;
+   sign = (v.u >> 16) & 0x8000;
+   exponent = ((v.u >> 23) & 0xFF) - 112;
+   mantissa = v.u & 0x7FFFFF;
+
+   if (((v.u >> 23) & 0xFF) == 0xFF)
+      return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+   if (exponent >= 31)
+      return sign | 0x7C00;
+   if (exponent <= 0)
+   {
+      // Subnormal or zero
+      if (exponent < -10)
+         return sign;
+      mantissa |= 0x800000;
+      return sign | ((mantissa >> (14 - exponent))
+                     + ((mantissa >> (13 - exponent)) & 1));
+   }
+   return (sign | (exponent << 10) | (mantissa >> 13))
+          + ((mantissa >> 12) & 1);
+}
+
+// Extract field from frame
+static union frame_value frame_decode_field (const struct frame_field *f,
+                                             const unsigned char *frame)
+{
+   union frame_value value;
+   const unsigned char *b = frame + f->byte_offset;
+   unsigned long long v = 0;
+   int i;
+
+   if (f->byte_aligned && f->little_endian)
+   {
+      for (i = f->nbytes - 1; i >= 0; i--)
+         v = v << 8 | b[i];
+   }
+   else
+   {
+      for (i = 0; i < f->nbytes; i++)
+         v = v << 8 | b[i];
+      v = (v >> f->rshift) & f->mask;
+   }
+
+   switch (f->type)
+   {
+   case FRAME_UINT:
+      value.i = (int) (unsigned int) v;
+      break;
+   case FRAME_INT:
+      if ((v >> (f->bits - 1)) & 1)
+         v |= ~f->mask;
+      value.i = (int) (long long) v;
+      break;
+   case FRAME_HALF:
+      value.f = frame_half_to_float ((unsigned int) v);
+      break;
+   case FRAME_FLOAT:
+      {
+         union
+         {
+            unsigned int u;
+            float f;
+         } fv;
+         fv.u = (unsigned int) v;
+         value.f = fv.f;
+      }
+      break;
+   case FRAME_DOUBLE:
+      {
+         union
+         {
+            unsigned long long u;
+            double d;
+         } dv;
+         dv.u = v;
+         value.f = (float) dv.d;
+      }
+      break;
+   default:
+      value.i = 0;
+      break;
+   }
+   return value;
+}
+
+// Insert field value to frame
+static void frame_encode_field (const struct frame_field *f,
+                                unsigned char *frame,
+                                union frame_value value)
+{
+   unsigned char *b = frame + f->byte_offset;
+   unsigned long long v;
+   int i;
+
+   switch (f->type)
+   {
+   case FRAME_HALF:
+      v = frame_float_to_half (value.f);
+      break;
+   case FRAME_FLOAT:
+      {
+         union
+         {
+            unsigned int u;
+            float f;
+         } fv;
+         fv.f = value.f;
+         v = fv.u;
+      }
+      break;
+   case FRAME_DOUBLE:
+      {
+         union
+         {
+            unsigned long long u;
+            double d;
+         } dv;
+         dv.d = value.f;
+         v = dv.u;
+      }
+      break;
+   case FRAME_INT:
+   case FRAME_UINT:
+      v = (unsigned int) value.i;
+      break;
+   default:
+      v = 0;
+      break;
+   }
+   v &= f->mask;
+
+   if (f->byte_aligned && f->little_endian)
+   {
+      for (i = 0; i < f->nbytes; i++, v >>= 8)
+         b[i] = (unsigned char) v;
+   }
+   else
+   {
+      // Merge with neighbouring fields sharing the edge bytes
+      unsigned long long old = 0;
+      unsigned long long m = f->mask << f->rshift;
+      for (i = 0; i < f->nbytes; i++)
+         old = old << 8 | b[i];
+      v = (old & ~m) | (v << f->rshift);
+      for (i = f->nbytes - 1; i >= 0; i--, v >>= 8)
+         b[i] = (unsigned char) v;
+   }
+}
+
+// Decode complete frame and send the values
+static void frame_codec_decode (const struct context_rmcios *context, int id,
+                                struct frame_codec_data *this)
+{
+   const unsigned char *frame = (const unsigned char *) this->frame;
+   int i, n = 0;
+   for (i = 0; i < this->num_fields; i++)
+   {
+      const struct frame_field *f = this->fields + i;
+      if (f->type == FRAME_PAD)
+         continue;
+      this->values[n] = frame_decode_field (f, frame);
+      if (f->channel != 0)
+      {
+         if (frame_is_integer (f))
+            write_i (context, f->channel, this->values[n].i);
+         else
+            write_f (context, f->channel, this->values[n].f);
+      }
+      n++;
+   }
+   if (this->integers)
+   {
+      int values[n + 1];
+      for (i = 0; i < n; i++)
+         values[i] = this->values[i].i;
+      write_iv (context, linked_channels (context, id), n, values);
+   }
+   else
+   {
+      // Mixed layout is sent as floats
+      float values[n + 1];
+      n = 0;
+      for (i = 0; i < this->num_fields; i++)
+      {
+         const struct frame_field *f = this->fields + i;
+         if (f->type == FRAME_PAD)
+            continue;
+         values[n] = frame_is_integer (f) ? (float) this->values[n].i
+                                          : this->values[n].f;
+         n++;
+      }
+      write_fv (context, linked_channels (context, id), n, values);
+   }
+}
+
+void frame_codec_class_func (struct frame_codec_data *this,
+                             const struct context_rmcios *context, int id,
+                             enum function_rmcios function,
+                             enum type_rmcios paramtype,
+                             struct combo_rmcios *returnv,
+                             int num_params, const union param_rmcios param)
+{
+   switch (function)
+   {
+   case help_rmcios:
+      return_string (context, returnv,
+               "frame codec - decode and encode binary frames"
+               " with declared layout\r\n"
+               "create frame_codec newname\r\n"
+               "setup newname type1 | channel1 | type2 | channel2 ...\r\n"
+               "  -Layout of the frame as field types in order."
+               " Each type can be followed by channel for the field value.\r\n"
+               "  -types:\r\n"
+               "    u8 u16 u24 u32 : unsigned big-endian integer\r\n"
+               "    i8 i16 i24 i32 : signed big-endian integer\r\n"
+               "    f16 f32 f64 : IEEE half, single and double float\r\n"
+               "    be or le prefix: byte order. example: le16 lei32 lef32\r\n"
+               "    bitsN : N bit unsigned field (MSB first, N<=32)\r\n"
+               "    ibitsN : N bit signed field (N<=32)\r\n"
+               "    padN : skip N bits\r\n"
+               "  -Integer fields are passed as int. u32 values above"
+               " 2147483647 have the same bits as negative int.\r\n"
+               "  -Float fields are passed as float."
+               " f64 values are rounded to float.\r\n"
+               "  -le fields must start at byte boundary.\r\n"
+               "  -example: setup frame u8 | be16 len | f32 temp |"
+               " i24 pressure | bits4 flags | pad4\r\n"
+               "write newname frame_data\r\n"
+               "  -Decode frames. Data can be split over writes.\r\n"
+               "  -Field values are written to field channels and"
+               " all values as single write to linked channels.\r\n"
+               "   Linked channels get ints when all fields are integers,"
+               " otherwise floats.\r\n"
+               "write newname\r\n"
+               "  -Reset partial frame\r\n"
+               "read newname\r\n"
+               "  -Encode frame from field channels values."
+               " Fields without channel use latest decoded value.\r\n"
+               "link newname channel\r\n");
+      break;
+
+   case create_rmcios:
+      if (num_params < 1)
+         break;
+      this = (struct frame_codec_data *)
+             allocate_storage (context, sizeof (struct frame_codec_data), 0);
+      if (this == 0)
+         break;
+      this->fields = 0;
+      this->num_fields = 0;
+      this->num_values = 0;
+      this->integers = 0;
+      this->values = 0;
+      this->frame = 0;
+      this->frame_size = 0;
+      this->frame_length = 0;
+      create_channel_param (context, paramtype, param, 0,
+                            (class_rmcios) frame_codec_class_func, this);
+      break;
+
+   case setup_rmcios:
+      if (this == 0)
+         break;
+      if (num_params < 1)
+         break;
+      {
+         struct frame_field *fields;
+         int num_fields = 0;
+         int num_values = 0;
+         int integers = 1;
+         int frame_size;
+         int i;
+
+         fields = (struct frame_field *)
+                  allocate_storage (context,
+                                    num_params * sizeof (struct frame_field),
+                                    0);
+         if (fields == 0)
+            break;
+
+         // Compile the layout
+         for (i = 0; i < num_params; i++)
+         {
+            char token[16];
+            const char *s;
+            int type;
+            s = param_to_string (context, paramtype, param, i,
+                                 sizeof (token), token);
+            type = frame_parse_type (s, fields + num_fields);
+            if (type < 0)
+               break;
+            if (type > 0)
+            {
+               fields[num_fields].channel = 0;
+               if (fields[num_fields].type != FRAME_PAD)
+               {
+                  num_values++;
+                  if (!frame_is_integer (fields + num_fields))
+                     integers = 0;
+               }
+               num_fields++;
+            }
+            else if (num_fields > 0)
+               fields[num_fields - 1].channel =
+                  param_to_int (context, paramtype, param, i);
+         }
+
+         frame_size = i < num_params ? -1
+                                     : frame_compile (fields, num_fields);
+         if (frame_size < 0)
+         {
+            info (context, context->errors,
+                  "frame_codec: integer field over 32 bits,"
+                  " le field not at byte boundary"
+                  " or unaligned field over 64 bits\r\n");
+            free_storage (context, fields, 0);
+            break;
+         }
+
+         if (this->fields != 0)
+            free_storage (context, this->fields, 0);
+         if (this->values != 0)
+            free_storage (context, this->values, 0);
+         if (this->frame != 0)
+            free_storage (context, this->frame, 0);
+         this->fields = fields;
+         this->num_fields = num_fields;
+         this->num_values = num_values;
+         this->integers = integers;
+         this->frame_size = frame_size;
+         this->frame_length = 0;
+         this->values = (union frame_value *)
+            allocate_storage (context,
+                              (num_values + 1) * sizeof (union frame_value),
+                              0);
+         this->frame = (char *) allocate_storage (context,
+                                                  this->frame_size + 1, 0);
+         if (this->values == 0 || this->frame == 0)
+            this->frame_size = 0;
+         for (i = 0; i < num_values && this->values != 0; i++)
+            this->values[i].i = 0;
+      }
+      break;
+
+   case write_rmcios:
+      if (this == 0)
+         break;
+      if (num_params < 1)
+      {
+         this->frame_length = 0;
+         break;
+      }
+      if (this->frame_size == 0)
+         break;
+      {
+         int blen = param_binary_length (context, paramtype, param, 0);
+         char buffer[blen];
+         struct buffer_rmcios p;
+         int i = 0;
+
+         p = param_to_binary (context, paramtype, param, 0, blen, buffer);
+         while (i < p.length)
+         {
+            // Collect frame
+            while (i < p.length && this->frame_length < this->frame_size)
+               this->frame[this->frame_length++] = p.data[i++];
+            if (this->frame_length < this->frame_size)
+               break;
+            frame_codec_decode (context, id, this);
+            this->frame_length = 0;
+         }
+      }
+      break;
+
+   case read_rmcios:
+      if (this == 0 || this->frame_size == 0)
+         break;
+      {
+         unsigned char frame[this->frame_size];
+         int i, n = 0;
+         for (i = 0; i < this->frame_size; i++)
+            frame[i] = 0;
+         for (i = 0; i < this->num_fields; i++)
+         {
+            const struct frame_field *f = this->fields + i;
+            if (f->type == FRAME_PAD)
+               continue;
+            if (f->channel != 0)
+            {
+               if (frame_is_integer (f))
+                  this->values[n].i = read_i (context, f->channel);
+               else
+                  this->values[n].f = read_f (context, f->channel);
+            }
+            frame_encode_field (f, frame, this->values[n]);
+            n++;
+         }
+         return_buffer (context, returnv, (char *) frame, this->frame_size);
+      }
+      break;
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////
+// COBS and SLIP framing channels
+//////////////////////////////////////////////////////////////////////////
+#define SLIP_END 0xC0
+#define SLIP_ESC 0xDB
+#define SLIP_ESC_END 0xDC
+#define SLIP_ESC_ESC 0xDD
+
+struct framer_data
+{
+   char *frame;                 // frame being decoded
+   int frame_size;
+   int frame_length;
+   char overflow;               // frame did not fit. skip to next frame
+
+   // COBS decoder state
+   int code;                    // code of current block. 0=none
+   int remaining;               // data bytes left in current block
+
+   // SLIP decoder state
+   char escape;
+
+   int frames;                  // encoded or decoded frames
+   int errors;                  // malformed or too long frames
+};
+
+// Default maximum decoded frame size
+#define FRAMER_FRAME_SIZE 256
+
+// Maximum COBS encoded size of len bytes including the delimiter.
+#define COBS_ENCODED_SIZE(len) ((len) + (len) / 254 + 2)
+
+// COBS encode frame and add the 0 delimiter.
+// Returns the number of bytes written to out.
+int cobs_encode (const unsigned char *in, int len, char *out)
+{
+   int code_index = 0;
+   int o = 1;
+   int i = 0;
+
+   while (i < len)
+   {
+      // Copy run of nonzero bytes up to the block limit.
+      int run = len - i;
+      int j;
+      if (run > 254)
+         run = 254;
+      run = scan_bytes (in + i, run, 0, 0);
+      for (j = 0; j < run; j++)
+         out[o++] = in[i + j];
+      i += run;
+
+      if (run == 254)
+      {
+         out[code_index] = (char) 0xFF;
+         code_index = o++;
+      }
+      else if (i < len)
+      {
+         // Zero byte ends the block
+         out[code_index] = run + 1;
+         code_index = o++;
+         i++;
+      }
+      else
+      {
+         out[code_index] = run + 1;
+         code_index = -1;
+      }
+   }
+   if (code_index >= 0)
+      out[code_index] = (o - code_index);
+   out[o++] = 0;
+   return o;
+}
+
+// SLIP encode frame with END bytes on both sides.
+// out needs room for len * 2 + 2 bytes.
+// Returns the number of bytes written to out.
+int slip_encode (const unsigned char *in, int len, char *out)
+{
+   int o = 0;
+   int i = 0;
+   out[o++] = (char) SLIP_END;
+   while (i < len)
+   {
+      int run = scan_bytes (in + i, len - i, SLIP_END, SLIP_ESC);
+      int j;
+      for (j = 0; j < run; j++)
+         out[o++] = in[i + j];
+      i += run;
+      if (i < len)
+      {
+         out[o++] = (char) SLIP_ESC;
+         out[o++] = (char) ((in[i] == SLIP_END) ? SLIP_ESC_END : SLIP_ESC_ESC);
+         i++;
+      }
+   }
+   out[o++] = (char) SLIP_END;
+   return o;
+}
+
+// Append bytes to the frame being decoded
+static void framer_append (struct framer_data *this,
+                           const unsigned char *data, int length)
+{
+   int i;
+   if (this->frame_length + length > this->frame_size)
+   {
+      this->overflow = 1;
+      return;
+   }
+   for (i = 0; i < length; i++)
+      this->frame[this->frame_length + i] = data[i];
+   this->frame_length += length;
+}
+
+// Send decoded frame to linked channels and start new one
+static void framer_emit (const struct context_rmcios *context, int id,
+                         struct framer_data *this, int valid)
+{
+   if (this->overflow || !valid)
+      this->errors++;
+   else
+   {
+      write_buffer (context, linked_channels (context, id),
+                    this->frame, this->frame_length, 0);
+      this->frames++;
+   }
+   this->frame_length = 0;
+   this->overflow = 0;
+}
+
+// Decode COBS stream. Complete frames are sent to linked channels.
+static void cobs_decode (const struct context_rmcios *context, int id,
+                         struct framer_data *this,
+                         const unsigned char *data, int length)
+{
+   int i = 0;
+   while (i < length)
+   {
+      if (this->remaining > 0)
+      {
+         // Copy the block data up to the delimiter.
+         int run = length - i;
+         if (run > this->remaining)
+            run = this->remaining;
+         run = scan_bytes (data + i, run, 0, 0);
+         framer_append (this, data + i, run);
+         this->remaining -= run;
+         i += run;
+         if (i >= length)
+            break;
+         if (this->remaining > 0)
+         {
+            // Delimiter inside block. Truncated frame.
+            framer_emit (context, id, this, 0);
+            this->code = 0;
+            this->remaining = 0;
+            i++;
+            continue;
+         }
+      }
+
+      if (data[i] == 0)
+      {
+         // Frame delimiter
+         if (this->code != 0)
+            framer_emit (context, id, this, 1);
+         this->code = 0;
+      }
+      else
+      {
+         // Next block. Blocks shorter than maximum end with zero.
+         static const unsigned char zero = 0;
+         if (this->code != 0 && this->code != 0xFF)
+            framer_append (this, &zero, 1);
+         this->code = data[i];
+         this->remaining = this->code - 1;
+      }
+      i++;
+   }
+}
+
+// Decode SLIP stream. Complete frames are sent to linked channels.
+static void slip_decode (const struct context_rmcios *context, int id,
+                         struct framer_data *this,
+                         const unsigned char *data, int length)
+{
+   int i = 0;
+   while (i < length)
+   {
+      unsigned char c;
+      if (this->escape == 0)
+      {
+         int run = scan_bytes (data + i, length - i, SLIP_END, SLIP_ESC);
+         framer_append (this, data + i, run);
+         i += run;
+         if (i >= length)
+            break;
+      }
+
+      c = data[i++];
+      if (this->escape)
+      {
+         this->escape = 0;
+         if (c == SLIP_ESC_END)
+         {
+            framer_append (this, (const unsigned char *) "\xC0", 1);
+            continue;
+         }
+         if (c == SLIP_ESC_ESC)
+         {
+            framer_append (this, (const unsigned char *) "\xDB", 1);
+            continue;
+         }
+         // Invalid escape drops the frame
+         this->overflow = 1;
+         if (c != SLIP_END)
+            continue;
+      }
+
+      if (c == SLIP_ESC)
+         this->escape = 1;
+      else if (this->frame_length > 0 || this->overflow)
+         // End of frame. Empty frames are skipped.
+         framer_emit (context, id, this, 1);
+   }
+}
+
+// Common implementation of framing channels.
+// encode and decode select the direction of the channel.
+static void framer_class_func (struct framer_data *this,
+                               const struct context_rmcios *context, int id,
+                               enum function_rmcios function,
+                               enum type_rmcios paramtype,
+                               struct combo_rmcios *returnv,
+                               int num_params, const union param_rmcios param,
+                               int (*encode) (const unsigned char *, int,
+                                              char *),
+                               void (*decode) (const struct context_rmcios *,
+                                               int, struct framer_data *,
+                                               const unsigned char *, int),
+                               class_rmcios class_func)
+{
+   switch (function)
+   {
+   case create_rmcios:
+      if (num_params < 1)
+         break;
+      this = (struct framer_data *)
+             allocate_storage (context, sizeof (struct framer_data), 0);
+      if (this == 0)
+         break;
+      this->frame_size = 0;
+      this->frame = 0;
+      if (decode != 0)
+      {
+         this->frame_size = FRAMER_FRAME_SIZE;
+         this->frame = (char *) allocate_storage (context, this->frame_size,
+                                                  0);
+         if (this->frame == 0)
+            this->frame_size = 0;
+      }
+      this->frame_length = 0;
+      this->overflow = 0;
+      this->code = 0;
+      this->remaining = 0;
+      this->escape = 0;
+      this->frames = 0;
+      this->errors = 0;
+      create_channel_param (context, paramtype, param, 0, class_func, this);
+      break;
+
+   case setup_rmcios:
+      if (this == 0 || decode == 0)
+         break;
+      if (num_params < 1)
+         break;
+      {
+         int frame_size = param_to_int (context, paramtype, param, 0);
+         if (frame_size < 1)
+            break;
+         if (this->frame != 0)
+            free_storage (context, this->frame, 0);
+         this->frame = (char *) allocate_storage (context, frame_size, 0);
+         this->frame_size = (this->frame != 0) ? frame_size : 0;
+         this->frame_length = 0;
+         this->overflow = 0;
+      }
+      break;
+
+   case write_rmcios:
+      if (num_params < 1)
+      {
+         // Reset decoder
+         if (this == 0)
+            break;
+         this->frame_length = 0;
+         this->overflow = 0;
+         this->code = 0;
+         this->remaining = 0;
+         this->escape = 0;
+         break;
+      }
+      {
+         int blen = param_binary_length (context, paramtype, param, 0);
+         char buffer[blen];
+         struct buffer_rmcios p;
+         p = param_to_binary (context, paramtype, param, 0, blen, buffer);
+
+         if (encode != 0)
+         {
+            // Each write is one frame
+            char encoded[COBS_ENCODED_SIZE (p.length) + p.length];
+            int n = encode ((const unsigned char *) p.data, p.length,
+                            encoded);
+            return_buffer (context, returnv, encoded, n);
+            if (this == 0)
+               break;
+            write_buffer (context, linked_channels (context, id),
+                          encoded, n, 0);
+            this->frames++;
+         }
+         else if (this != 0)
+            decode (context, id, this, (const unsigned char *) p.data,
+                    p.length);
+      }
+      break;
+
+   case read_rmcios:
+      if (this == 0)
+         break;
+      return_int (context, returnv, this->frames);
+      break;
+   }
+}
+
+void cobs_encoder_class_func (struct framer_data *this,
+                              const struct context_rmcios *context, int id,
+                              enum function_rmcios function,
+                              enum type_rmcios paramtype,
+                              struct combo_rmcios *returnv,
+                              int num_params, const union param_rmcios param)
+{
+   if (function == help_rmcios)
+   {
+      return_string (context, returnv,
+                     "COBS encoder - Consistent Overhead Byte Stuffing\r\n"
+                     "create cobs_enc newname\r\n"
+                     "write newname frame\r\n"
+                     "  -encode frame. Returns the encoded frame"
+                     " with 0 delimiter.\r\n"
+                     "  -encoded frame is sent to linked channels\r\n"
+                     "read newname\r\n"
+                     "  -number of encoded frames\r\n"
+                     "link newname channel\r\n");
+      return;
+   }
+   framer_class_func (this, context, id, function, paramtype, returnv,
+                      num_params, param, cobs_encode, 0,
+                      (class_rmcios) cobs_encoder_class_func);
+}
+
+void cobs_decoder_class_func (struct framer_data *this,
+                              const struct context_rmcios *context, int id,
+                              enum function_rmcios function,
+                              enum type_rmcios paramtype,
+                              struct combo_rmcios *returnv,
+                              int num_params, const union param_rmcios param)
+{
+   if (function == help_rmcios)
+   {
+      return_string (context, returnv,
+                     "COBS decoder - Consistent Overhead Byte Stuffing\r\n"
+                     "create cobs_dec newname\r\n"
+                     "setup newname max_frame_size(256)\r\n"
+                     "write newname data\r\n"
+                     "  -decode stream. Frames may be split over writes.\r\n"
+                     "  -each decoded frame is sent to linked channels"
+                     " as single write.\r\n"
+                     "  -malformed and too long frames are dropped.\r\n"
+                     "write newname\r\n"
+                     "  -reset the decoder\r\n"
+                     "read newname\r\n"
+                     "  -number of decoded frames\r\n"
+                     "link newname channel\r\n");
+      return;
+   }
+   framer_class_func (this, context, id, function, paramtype, returnv,
+                      num_params, param, 0, cobs_decode,
+                      (class_rmcios) cobs_decoder_class_func);
+}
+
+void slip_encoder_class_func (struct framer_data *this,
+                              const struct context_rmcios *context, int id,
+                              enum function_rmcios function,
+                              enum type_rmcios paramtype,
+                              struct combo_rmcios *returnv,
+                              int num_params, const union param_rmcios param)
+{
+   if (function == help_rmcios)
+   {
+      return_string (context, returnv,
+                     "SLIP encoder - RFC 1055 serial line framing\r\n"
+                     "create slip_enc newname\r\n"
+                     "write newname frame\r\n"
+                     "  -encode frame. Returns the escaped frame"
+                     " between END bytes\r\n"
+                     "  -encoded frame is sent to linked channels\r\n"
+                     "read newname\r\n"
+                     "  -number of encoded frames\r\n"
+                     "link newname channel\r\n");
+      return;
+   }
+   framer_class_func (this, context, id, function, paramtype, returnv,
+                      num_params, param, slip_encode, 0,
+                      (class_rmcios) slip_encoder_class_func);
+}
+
+void slip_decoder_class_func (struct framer_data *this,
+                              const struct context_rmcios *context, int id,
+                              enum function_rmcios function,
+                              enum type_rmcios paramtype,
+                              struct combo_rmcios *returnv,
+                              int num_params, const union param_rmcios param)
+{
+   if (function == help_rmcios)
+   {
+      return_string (context, returnv,
+                     "SLIP decoder - RFC 1055 serial line framing\r\n"
+                     "create slip_dec newname\r\n"
+                     "setup newname max_frame_size(256)\r\n"
+                     "write newname data\r\n"
+                     "  -decode stream. Frames may be split over writes.\r\n"
+                     "  -each decoded frame is sent to linked channels"
+                     " as single write.\r\n"
+                     "  -malformed and too long frames are dropped.\r\n"
+                     "write newname\r\n"
+                     "  -reset the decoder\r\n"
+                     "read newname\r\n"
+                     "  -number of decoded frames\r\n"
+                     "link newname channel\r\n");
+      return;
+   }
+   framer_class_func (this, context, id, function, paramtype, returnv,
+                      num_params, param, 0, slip_decode,
+                      (class_rmcios) slip_decoder_class_func);
+}
+
 // function for dynamically loading the module
 void init_encoding_channels (const struct context_rmcios *context)
 {
@@ -898,5 +3197,19 @@ void init_encoding_channels (const struct context_rmcios *context)
                        (class_rmcios) binary_encoder_class_func, 0);
    create_channel_str (context, "bin_dec",
                        (class_rmcios) binary_decoder_class_func, 0);
+   create_channel_str (context, "varint_enc",
+                       (class_rmcios) varint_encoder_class_func, 0);
+   create_channel_str (context, "varint_dec",
+                       (class_rmcios) varint_decoder_class_func, 0);
+   create_channel_str (context, "frame_codec",
+                       (class_rmcios) frame_codec_class_func, 0);
+   create_channel_str (context, "cobs_enc",
+                       (class_rmcios) cobs_encoder_class_func, 0);
+   create_channel_str (context, "cobs_dec",
+                       (class_rmcios) cobs_decoder_class_func, 0);
+   create_channel_str (context, "slip_enc",
+                       (class_rmcios) slip_encoder_class_func, 0);
+   create_channel_str (context, "slip_dec",
+                       (class_rmcios) slip_decoder_class_func, 0);
 }
 
@@ -0,0 +1,504 @@
+/* 
+RMCIOS - Reactive Multipurpose Control Input Output System
+Copyright (c) 2018 Frans Korhonen
+
+RMCIOS was originally developed at Institute for Atmospheric 
+and Earth System Research / Physics, Faculty of Science, 
+University of Helsinki, Finland
+
+Assistance, experience and feedback from following persons have been 
+critical for development of RMCIOS: Erkki Siivola, Juha Kangasluoma, 
+Lauri Ahonen, Ella Häkkinen, Pasi Aalto, Joonas Enroth, Runlong Cai, 
+Markku Kulmala and Tuukka Petäjä.
+
+This file is part of RMCIOS. This notice was encoded using utf-8.
+
+RMCIOS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RMCIOS is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public Licenses
+along with RMCIOS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Number formatting functions.
+ * Floats are converted with the Ryu algorithm (Ulf Adams, 2018)
+ * to the shortest decimal that reads back to the same float.
+ *
+ * Changelog: (date,who,description)
+ */
+#include "number_format.h"
+
+static const char digit_pairs[200] =
+   "00010203040506070809"
+   "10111213141516171819"
+   "20212223242526272829"
+   "30313233343536373839"
+   "40414243444546474849"
+   "50515253545556575859"
+   "60616263646566676869"
+   "70717273747576777879"
+   "80818283848586878889"
+   "90919293949596979899";
+
+// Write digits of value ending to end. Returns pointer to first digit.
+static char *format_digits (char *end, unsigned long long value)
+{
+   while (value >= 100)
+   {
+      const char *pair = digit_pairs + (value % 100) * 2;
+      value /= 100;
+      *--end = pair[1];
+      *--end = pair[0];
+   }
+   if (value >= 10)
+   {
+      const char *pair = digit_pairs + value * 2;
+      *--end = pair[1];
+      *--end = pair[0];
+   }
+   else
+      *--end = '0' + (char) value;
+   return end;
+}
+
+// Copy number to s right aligned to width
+static int format_align (char *s, const char *number, int length,
+                         int width, char pad)
+{
+   int i = 0, j;
+   if (pad == '0' && (*number == '-') && width > length)
+   {
+      // Sign before zero padding
+      s[i++] = *number++;
+      length--;
+      width--;
+   }
+   while (width-- > length)
+      s[i++] = pad;
+   for (j = 0; j < length; j++)
+      s[i++] = number[j];
+   return i;
+}
+
+int format_int (char *s, int value, int width, char pad)
+{
+   char buffer[12];
+   char *end = buffer + sizeof (buffer);
+   char *start;
+   unsigned int magnitude = value < 0 ? 0u - (unsigned int) value
+                                      : (unsigned int) value;
+   start = format_digits (end, magnitude);
+   if (value < 0)
+      *--start = '-';
+   return format_align (s, start, (int) (end - start), width, pad);
+}
+
+////////////////////////////////////////////////////////////////////////
+// Shortest float to decimal conversion (Ryu)
+////////////////////////////////////////////////////////////////////////
+#define FLOAT_MANTISSA_BITS 23
+#define FLOAT_EXPONENT_BITS 8
+#define FLOAT_BIAS 127
+#define FLOAT_POW5_INV_BITCOUNT 59
+#define FLOAT_POW5_BITCOUNT 61
+
+// floor(2^(ceil(log2(5^i)) - 1 + 59) / 5^i) + 1
+static const unsigned long long float_pow5_inv_split[31] = {
+   0x0800000000000001ULL, 0x0666666666666667ULL,
+   0x051EB851EB851EB9ULL, 0x04189374BC6A7EFAULL,
+   0x068DB8BAC710CB2AULL, 0x053E2D6238DA3C22ULL,
+   0x0431BDE82D7B634EULL, 0x06B5FCA6AF2BD216ULL,
+   0x055E63B88C230E78ULL, 0x044B82FA09B5A52DULL,
+   0x06DF37F675EF6EAEULL, 0x057F5FF85E592558ULL,
+   0x0465E6604B7A8447ULL, 0x0709709A125DA071ULL,
+   0x05A126E1A84AE6C1ULL, 0x0480EBE7B9D58567ULL,
+   0x0734ACA5F6226F0BULL, 0x05C3BD5191B525A3ULL,
+   0x049C97747490EAE9ULL, 0x0760F253EDB4AB0EULL,
+   0x05E72843249088D8ULL, 0x04B8ED0283A6D3E0ULL,
+   0x078E480405D7B966ULL, 0x060B6CD004AC9452ULL,
+   0x04D5F0A66A23A9DBULL, 0x07BCB43D769F762BULL,
+   0x063090312BB2C4EFULL, 0x04F3A68DBC8F03F3ULL,
+   0x07EC3DAF94180651ULL, 0x065697BFA9ACD1DAULL,
+   0x051212FFBAF0A7E2ULL
+};
+
+// 5^i normalized to 61 bits
+static const unsigned long long float_pow5_split[47] = {
+   0x1000000000000000ULL, 0x1400000000000000ULL,
+   0x1900000000000000ULL, 0x1F40000000000000ULL,
+   0x1388000000000000ULL, 0x186A000000000000ULL,
+   0x1E84800000000000ULL, 0x1312D00000000000ULL,
+   0x17D7840000000000ULL, 0x1DCD650000000000ULL,
+   0x12A05F2000000000ULL, 0x174876E800000000ULL,
+   0x1D1A94A200000000ULL, 0x12309CE540000000ULL,
+   0x16BCC41E90000000ULL, 0x1C6BF52634000000ULL,
+   0x11C37937E0800000ULL, 0x16345785D8A00000ULL,
+   0x1BC16D674EC80000ULL, 0x1158E460913D0000ULL,
+   0x15AF1D78B58C4000ULL, 0x1B1AE4D6E2EF5000ULL,
+   0x10F0CF064DD59200ULL, 0x152D02C7E14AF680ULL,
+   0x1A784379D99DB420ULL, 0x108B2A2C28029094ULL,
+   0x14ADF4B7320334B9ULL, 0x19D971E4FE8401E7ULL,
+   0x1027E72F1F128130ULL, 0x1431E0FAE6D7217CULL,
+   0x193E5939A08CE9DBULL, 0x1F8DEF8808B02452ULL,
+   0x13B8B5B5056E16B3ULL, 0x18A6E32246C99C60ULL,
+   0x1ED09BEAD87C0378ULL, 0x13426172C74D822BULL,
+   0x1812F9CF7920E2B6ULL, 0x1E17B84357691B64ULL,
+   0x12CED32A16A1B11EULL, 0x178287F49C4A1D66ULL,
+   0x1D6329F1C35CA4BFULL, 0x125DFA371A19E6F7ULL,
+   0x16F578C4E0A060B5ULL, 0x1CB2D6F618C878E3ULL,
+   0x11EFC659CF7D4B8DULL, 0x166BB7F0435C9E71ULL,
+   0x1C06A5EC5433C60DULL
+};
+
+// ceil(log2(5^e)), 1 for e=0
+static int pow5bits (int e)
+{
+   return (int) (((unsigned int) e * 1217359) >> 19) + 1;
+}
+
+// floor(log10(2^e))
+static int log10_pow2 (int e)
+{
+   return (int) (((unsigned int) e * 78913) >> 18);
+}
+
+// floor(log10(5^e))
+static int log10_pow5 (int e)
+{
+   return (int) (((unsigned int) e * 732923) >> 20);
+}
+
+static int pow5_factor (unsigned int value)
+{
+   int count = 0;
+   while (value % 5 == 0)
+   {
+      value /= 5;
+      count++;
+   }
+   return count;
+}
+
+static unsigned int mul_shift (unsigned int m, unsigned long long factor,
+                               int shift)
+{
+   unsigned long long low = (unsigned long long) m * (unsigned int) factor;
+   unsigned long long high = (unsigned long long) m
+      * (unsigned int) (factor >> 32);
+   return (unsigned int) (((low >> 32) + high) >> (shift - 32));
+}
+
+// Shortest decimal digits and exponent of finite nonzero float bits
+static unsigned int float_to_decimal (unsigned int mantissa, int exponent,
+                                      int *decimal_exponent)
+{
+   int e2, e10, q, i, j, k, removed = 0;
+   unsigned int m2, mv, mp, mm, vr, vp, vm, output;
+   int mm_shift, accept_bounds;
+   int vm_trailing_zeros = 0, vr_trailing_zeros = 0;
+   unsigned int last_removed_digit = 0;
+
+   if (exponent == 0)
+   {
+      e2 = 1 - FLOAT_BIAS - FLOAT_MANTISSA_BITS - 2;
+      m2 = mantissa;
+   }
+   else
+   {
+      e2 = exponent - FLOAT_BIAS - FLOAT_MANTISSA_BITS - 2;
+      m2 = (1u << FLOAT_MANTISSA_BITS) | mantissa;
+   }
+   accept_bounds = (m2 & 1) == 0;
+
+   // Value and the halfway points to the neighbour floats
+   mv = 4 * m2;
+   mp = 4 * m2 + 2;
+   mm_shift = mantissa != 0 || exponent <= 1;
+   mm = 4 * m2 - 1 - mm_shift;
+
+   if (e2 >= 0)
+   {
+      q = log10_pow2 (e2);
+      e10 = q;
+      k = FLOAT_POW5_INV_BITCOUNT + pow5bits (q) - 1;
+      i = -e2 + q + k;
+      vr = mul_shift (mv, float_pow5_inv_split[q], i);
+      vp = mul_shift (mp, float_pow5_inv_split[q], i);
+      vm = mul_shift (mm, float_pow5_inv_split[q], i);
+      if (q != 0 && (vp - 1) / 10 <= vm / 10)
+      {
+         int l = FLOAT_POW5_INV_BITCOUNT + pow5bits (q - 1) - 1;
+         last_removed_digit =
+            mul_shift (mv, float_pow5_inv_split[q - 1], -e2 + q - 1 + l)
+            % 10;
+      }
+      if (q <= 9)
+      {
+         if (mv % 5 == 0)
+            vr_trailing_zeros = pow5_factor (mv) >= q;
+         else if (accept_bounds)
+            vm_trailing_zeros = pow5_factor (mm) >= q;
+         else
+            vp -= pow5_factor (mp) >= q;
+      }
+   }
+   else
+   {
+      q = log10_pow5 (-e2);
+      e10 = q + e2;
+      i = -e2 - q;
+      k = pow5bits (i) - FLOAT_POW5_BITCOUNT;
+      j = q - k;
+      vr = mul_shift (mv, float_pow5_split[i], j);
+      vp = mul_shift (mp, float_pow5_split[i], j);
+      vm = mul_shift (mm, float_pow5_split[i], j);
+      if (q != 0 && (vp - 1) / 10 <= vm / 10)
+      {
+         j = q - 1 - (pow5bits (i + 1) - FLOAT_POW5_BITCOUNT);
+         last_removed_digit = mul_shift (mv, float_pow5_split[i + 1], j)
+            % 10;
+      }
+      if (q <= 1)
+      {
+         vr_trailing_zeros = 1;
+         if (accept_bounds)
+            vm_trailing_zeros = mm_shift == 1;
+         else
+            vp--;
+      }
+      else if (q < 31)
+         vr_trailing_zeros = (mv & ((1u << (q - 1)) - 1)) == 0;
+   }
+
+   // Remove digits while the value stays between the halfway points
+   if (vm_trailing_zeros || vr_trailing_zeros)
+   {
+      while (vp / 10 > vm / 10)
+      {
+         vm_trailing_zeros &= vm % 10 == 0;
+         vr_trailing_zeros &= last_removed_digit == 0;
+         last_removed_digit = vr % 10;
+         vr /= 10;
+         vp /= 10;
+         vm /= 10;
+         removed++;
+      }
+      if (vm_trailing_zeros)
+      {
+         while (vm % 10 == 0)
+         {
+            vr_trailing_zeros &= last_removed_digit == 0;
+            last_removed_digit = vr % 10;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+         }
+      }
+      if (vr_trailing_zeros && last_removed_digit == 5 && vr % 2 == 0)
+         last_removed_digit = 4;        // Round even
+      output = vr + ((vr == vm && (!accept_bounds || !vm_trailing_zeros))
+                     || last_removed_digit >= 5);
+   }
+   else
+   {
+      while (vp / 10 > vm / 10)
+      {
+         last_removed_digit = vr % 10;
+         vr /= 10;
+         vp /= 10;
+         vm /= 10;
+         removed++;
+      }
+      output = vr + (vr == vm || last_removed_digit >= 5);
+   }
+   *decimal_exponent = e10 + removed;
+   return output;
+}
+
+// Format digits * 10^exponent. Scientific notation is used for
+// exponents outside of -5..8 like in printf %g.
+static int format_decimal (char *s, unsigned int digits, int exponent)
+{
+   char buffer[10];
+   char *end = buffer + sizeof (buffer);
+   char *d = format_digits (end, digits);
+   int length = (int) (end - d);
+   int scientific = exponent + length - 1;
+   int n = 0, i;
+
+   if (scientific < -5 || scientific > 8)
+   {
+      s[n++] = d[0];
+      if (length > 1)
+      {
+         s[n++] = '.';
+         for (i = 1; i < length; i++)
+            s[n++] = d[i];
+      }
+      s[n++] = 'e';
+      s[n++] = scientific < 0 ? '-' : '+';
+      if (scientific < 0)
+         scientific = -scientific;
+      // Float exponents have at most two digits
+      s[n++] = digit_pairs[scientific * 2];
+      s[n++] = digit_pairs[scientific * 2 + 1];
+      return n;
+   }
+   if (scientific < 0)
+   {
+      // 0.000ddd
+      s[n++] = '0';
+      s[n++] = '.';
+      for (i = scientific + 1; i < 0; i++)
+         s[n++] = '0';
+      for (i = 0; i < length; i++)
+         s[n++] = d[i];
+   }
+   else if (exponent >= 0)
+   {
+      // ddd000
+      for (i = 0; i < length; i++)
+         s[n++] = d[i];
+      for (i = 0; i < exponent; i++)
+         s[n++] = '0';
+   }
+   else
+   {
+      // dd.ddd
+      for (i = 0; i < length; i++)
+      {
+         if (i == length + exponent)
+            s[n++] = '.';
+         s[n++] = d[i];
+      }
+   }
+   return n;
+}
+
+static const double format_pow10[] = {
+   1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9
+};
+
+// Fixed number of decimals. Returns 0 when value is too large.
+static int format_fixed (char *s, float value, int negative, int precision)
+{
+   double v = negative ? -(double) value : value;
+   unsigned long long integer, fraction;
+   double rest;
+   char buffer[32];
+   char *end = buffer + sizeof (buffer);
+   char *start;
+   int n = 0;
+
+   if (v >= 1e18)
+      return 0;
+   if (precision > 9)
+      precision = 9;
+   integer = (unsigned long long) v;
+   // Fraction part is exact in double. Round half to even.
+   rest = (v - (double) integer) * format_pow10[precision];
+   fraction = (unsigned long long) rest;
+   rest -= (double) fraction;
+   if (rest > 0.5
+       || (rest == 0.5 && ((precision > 0 ? fraction : integer) & 1)))
+      fraction++;
+   if (fraction >= (unsigned long long) format_pow10[precision])
+   {
+      fraction = 0;
+      integer++;
+   }
+
+   if (precision > 0)
+   {
+      int i;
+      char *f = format_digits (end, fraction);
+      for (i = (int) (end - f); i < precision; i++)
+         *--f = '0';
+      *--f = '.';
+      end = f;
+   }
+   start = format_digits (end, integer);
+   if (negative)
+      *--start = '-';
+   while (start < buffer + sizeof (buffer))
+      s[n++] = *start++;
+   return n;
+}
+
+int format_float (char *s, float value, int precision, int width)
+{
+   union
+   {
+      float f;
+      unsigned int u;
+   } v;
+   char buffer[NUMBER_FORMAT_SIZE];
+   char *b = buffer;
+   unsigned int mantissa;
+   int exponent, negative, length = 0;
+
+   v.f = value;
+   mantissa = v.u & ((1u << FLOAT_MANTISSA_BITS) - 1);
+   exponent = (v.u >> FLOAT_MANTISSA_BITS) & ((1 << FLOAT_EXPONENT_BITS) - 1);
+   negative = v.u >> 31;
+
+   if (exponent == (1 << FLOAT_EXPONENT_BITS) - 1)
+   {
+      const char *special = mantissa != 0 ? "nan"
+         : negative ? "-inf" : "inf";
+      for (length = 0; special[length] != 0; length++)
+         buffer[length] = special[length];
+   }
+   else if (precision >= 0)
+      length = format_fixed (buffer, value, negative, precision);
+
+   if (length == 0)
+   {
+      // Shortest representation
+      if (negative)
+         *b++ = '-';
+      if (exponent == 0 && mantissa == 0)
+         *b++ = '0';
+      else
+      {
+         int decimal_exponent;
+         unsigned int digits = float_to_decimal (mantissa, exponent,
+                                                 &decimal_exponent);
+         b += format_decimal (b, digits, decimal_exponent);
+      }
+      length = (int) (b - buffer);
+   }
+   return format_align (s, buffer, length, width, ' ');
+}
+
+void return_int_formatted (const struct context_rmcios *context,
+                           struct combo_rmcios *returnv, int value)
+{
+   if (returnv != 0 && returnv->paramtype == buffer_rmcios)
+   {
+      char s[NUMBER_FORMAT_SIZE];
+      return_buffer (context, returnv, s, format_int (s, value, 0, ' '));
+   }
+   else
+      return_int (context, returnv, value);
+}
+
+void return_float_formatted (const struct context_rmcios *context,
+                             struct combo_rmcios *returnv, float value)
+{
+   if (returnv != 0 && returnv->paramtype == buffer_rmcios)
+   {
+      char s[NUMBER_FORMAT_SIZE];
+      return_buffer (context, returnv, s, format_float (s, value, -1, 0));
+   }
+   else
+      return_float (context, returnv, value);
+}
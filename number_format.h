@@ -0,0 +1,69 @@
+/* 
+RMCIOS - Reactive Multipurpose Control Input Output System
+Copyright (c) 2018 Frans Korhonen
+
+RMCIOS was originally developed at Institute for Atmospheric 
+and Earth System Research / Physics, Faculty of Science, 
+University of Helsinki, Finland
+
+Assistance, experience and feedback from following persons have been 
+critical for development of RMCIOS: Erkki Siivola, Juha Kangasluoma, 
+Lauri Ahonen, Ella Häkkinen, Pasi Aalto, Joonas Enroth, Runlong Cai, 
+Markku Kulmala and Tuukka Petäjä.
+
+This file is part of RMCIOS. This notice was encoded using utf-8.
+
+RMCIOS is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RMCIOS is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public Licenses
+along with RMCIOS.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Number formatting functions shared by the channel modules.
+ *
+ * Changelog: (date,who,description)
+ */
+#ifndef NUMBER_FORMAT_H
+#define NUMBER_FORMAT_H
+
+#include "RMCIOS-functions.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Buffer size that fits any formatted number without width padding
+#define NUMBER_FORMAT_SIZE 48
+
+// Format integer to s. Number is right aligned to width characters
+// using pad character. Returns number of characters written.
+// s is not zero terminated.
+extern int format_int (char *s, int value, int width, char pad) ;
+
+// Format float to s. precision < 0 gives the shortest representation
+// that reads back to the same float. precision >= 0 gives fixed number
+// of decimals. Returns number of characters written.
+// s is not zero terminated.
+extern int format_float (char *s, float value, int precision, int width) ;
+
+// Return value. Values returned to buffer are formatted with
+// format_int/format_float.
+extern void return_int_formatted (const struct context_rmcios *context,
+                                  struct combo_rmcios *returnv, int value) ;
+extern void return_float_formatted (const struct context_rmcios *context,
+                                    struct combo_rmcios *returnv,
+                                    float value) ;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
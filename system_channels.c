@@ -35,6 +35,7 @@ along with RMCIOS.  If not, see <http://www.gnu.org/licenses/>.
  * */
 
 #include "RMCIOS-functions.h"
+#include "number_format.h"
 
 /* Compare strings (glibc)*/
 static int strcmp (const char *p1, const char *p2)
@@ -261,15 +262,16 @@ void float_class_func (struct float_data *this,
    case read_rmcios:
       if (this == 0)
          break;
-      return_float (context, returnv, this->value);
+      return_float_formatted (context, returnv, this->value);
       break;
    case write_rmcios:
       if (num_params > 0)
       {
          if (this == 0)
          {
-            return_float (context, returnv, 
-                          param_to_float (context, paramtype, param, 0) );
+            return_float_formatted (context, returnv,
+                                    param_to_float (context, paramtype,
+                                                    param, 0));
             break;
          }
          this->value = param_to_float (context, paramtype, param, 0);
@@ -335,7 +337,7 @@ void int_class_func (struct int_data *this,
    case read_rmcios:
       if (this == 0)
          break;
-      return_int (context, returnv, this->value);
+      return_int_formatted (context, returnv, this->value);
       break;
    case write_rmcios:
   
@@ -343,7 +345,7 @@ void int_class_func (struct int_data *this,
       {
          if (this == 0)
          {  
-               return_int (context, returnv, 
+               return_int_formatted (context, returnv,
                      param_to_int (context, paramtype, param, 0));
             break;
          }
@@ -506,7 +508,92 @@ void chain_class_func (void *this,
    }
 }
 
-void binary_class_func (void *this,
+/////////////////////////////////////////////////////////////////
+// Channel for converting bit fields of binary data
+/////////////////////////////////////////////////////////////////
+struct binary_data
+{
+   // Configuration
+   int bit_offset;
+   int bit_count;               // 0=continuous
+   int num_fields;
+   int *fields_bits;
+   int *channels;
+
+   // Reception state
+   unsigned long long reg;      // bits not yet assigned to fields
+   int reg_bits;
+   int skip_bits;               // bits left to skip before reception
+   int received_bits;           // bits received to fields
+   int field_index;
+};
+
+static void binary_reset (struct binary_data *this)
+{
+   this->reg = 0;
+   this->reg_bits = 0;
+   this->skip_bits = this->bit_offset;
+   this->received_bits = 0;
+   this->field_index = 0;
+}
+
+// Route fields from data. Bytes are shifted to the register several
+// at a time, and fields are taken from the register with single shift.
+static void binary_receive (const struct context_rmcios *context,
+                            struct binary_data *this,
+                            const unsigned char *data, int length)
+{
+   int i = 0;
+   while (i < length || this->reg_bits > 0)
+   {
+      int bits;
+      unsigned int value;
+
+      // Fill the register with whole bytes
+      while (i < length && this->reg_bits <= 56)
+      {
+         this->reg = this->reg << 8 | data[i++];
+         this->reg_bits += 8;
+      }
+
+      if (this->skip_bits > 0)
+      {
+         int skip = this->skip_bits;
+         if (skip > this->reg_bits)
+            skip = this->reg_bits;
+         this->reg_bits -= skip;
+         this->skip_bits -= skip;
+         if (this->skip_bits > 0)
+            continue;
+      }
+
+      if (this->bit_count > 0 && this->received_bits >= this->bit_count)
+      {
+         // Reception complete. Discard rest until reset.
+         this->reg_bits = 0;
+         return;
+      }
+
+      bits = this->fields_bits[this->field_index];
+      // Last field is cut at bit count. Read keeps the same high bits.
+      if (this->bit_count > 0 && bits > this->bit_count - this->received_bits)
+         bits = this->bit_count - this->received_bits;
+      if (this->reg_bits < bits)
+         return;                // Wait for more data
+
+      value = (unsigned int) (this->reg >> (this->reg_bits - bits))
+              & (0xFFFFFFFFu >> (32 - bits));
+      this->reg_bits -= bits;
+      this->received_bits += bits;
+
+      if (this->channels[this->field_index] != 0)
+         write_i (context, this->channels[this->field_index], value);
+      if (++this->field_index >= this->num_fields)
+         this->field_index = 0;
+   }
+}
+
+void binary_class_func (struct binary_data *this,
                         const struct context_rmcios *context, int id,
                         enum function_rmcios function,
                         enum type_rmcios paramtype,
@@ -528,9 +615,9 @@ void binary_class_func (void *this,
                      "   -After last channel the reception continues"
                      " with first channel field. \r\n"
                      "   -Setting bit_count to 0 means continuous"
-                     " readout (loops forever)"
-                     "   -field bit witdths and channels can be used for "
-                     " both direction conversions"
+                     " readout (loops forever)\r\n"
+                     "   -field bit witdths (1-32) and channels can be used for "
+                     " both direction conversions\r\n"
                      "write newname\r\n"
                      " -reset reception counters to 0\r\n"
                      "write newname data\r\n"
@@ -539,6 +626,162 @@ void binary_class_func (void *this,
                      "  -read binary data formed from configured channels data.\r\n");
       break;
 
+   case create_rmcios:
+      if (num_params < 1)
+         break;
+      this = (struct binary_data *)
+             allocate_storage (context, sizeof (struct binary_data), 0);
+      if (this == 0)
+         break;
+      this->bit_offset = 0;
+      this->bit_count = 0;
+      this->num_fields = 0;
+      this->fields_bits = 0;
+      this->channels = 0;
+      binary_reset (this);
+
+      // create channel
+      create_channel_param (context, paramtype, param, 0,
+                            (class_rmcios) binary_class_func, this);
+      break;
+
+   case setup_rmcios:
+      if (this == 0)
+         break;
+      if (num_params < 2)
+         break;
+      {
+         int num_fields = (num_params - 2) / 2;
+         int i;
+         this->bit_offset = param_to_int (context, paramtype, param, 0);
+         this->bit_count = param_to_int (context, paramtype, param, 1);
+         if (this->bit_offset < 0)
+            this->bit_offset = 0;
+         if (this->bit_count < 0)
+            this->bit_count = 0;
+
+         if (this->fields_bits != 0)
+            free_storage (context, this->fields_bits, 0);
+         if (this->channels != 0)
+            free_storage (context, this->channels, 0);
+         this->num_fields = 0;
+         this->fields_bits = 0;
+         this->channels = 0;
+         if (num_fields > 0)
+         {
+            this->fields_bits =
+               (int *) allocate_storage (context, num_fields * sizeof (int),
+                                         0);
+            this->channels =
+               (int *) allocate_storage (context, num_fields * sizeof (int),
+                                         0);
+         }
+         if (this->fields_bits != 0 && this->channels != 0)
+         {
+            this->num_fields = num_fields;
+            for (i = 0; i < num_fields; i++)
+            {
+               int bits = param_to_int (context, paramtype, param,
+                                        2 + i * 2);
+               if (bits < 1)
+                  bits = 1;
+               if (bits > 32)
+                  bits = 32;
+               this->fields_bits[i] = bits;
+               this->channels[i] = param_to_int (context, paramtype, param,
+                                                 3 + i * 2);
+            }
+         }
+         binary_reset (this);
+      }
+      break;
+
+   case write_rmcios:
+      if (this == 0)
+         break;
+      if (num_params < 1)
+      {
+         binary_reset (this);
+         break;
+      }
+      if (this->num_fields == 0)
+         break;
+      if (paramtype == buffer_rmcios)
+      {
+         // Convert directly from the parameter buffer
+         binary_receive (context, this,
+                         (const unsigned char *) param.bv[0].data,
+                         param.bv[0].length);
+      }
+      else
+      {
+         int blen = param_binary_length (context, paramtype, param, 0);
+         {
+            char buffer[blen];
+            struct buffer_rmcios p;
+            p = param_to_binary (context, paramtype, param, 0, blen, buffer);
+            binary_receive (context, this, (const unsigned char *) p.data,
+                            p.length);
+         }
+      }
+      break;
+
+   case read_rmcios:
+      if (this == 0)
+         break;
+      if (this->num_fields == 0)
+         break;
+      {
+         // Form binary data from the channel values
+         int data_bits = this->bit_count;
+         int i;
+         if (data_bits == 0)
+         {
+            for (i = 0; i < this->num_fields; i++)
+               data_bits += this->fields_bits[i];
+         }
+         {
+            int length = (this->bit_offset + data_bits + 7) >> 3;
+            unsigned char data[length];
+            unsigned long long reg = 0;
+            int reg_bits = this->bit_offset;
+            int bits_left = data_bits;
+            int n = 0;
+
+            // Leading offset as zero bits
+            while (reg_bits >= 8)
+            {
+               data[n++] = 0;
+               reg_bits -= 8;
+            }
+            for (i = 0; bits_left > 0; i++)
+            {
+               int field = i % this->num_fields;
+               int bits = this->fields_bits[field];
+               unsigned int value = 0;
+               if (this->channels[field] != 0)
+                  value = read_i (context, this->channels[field]);
+               if (bits > bits_left)
+               {
+                  value >>= bits - bits_left;
+                  bits = bits_left;
+               }
+               reg = reg << bits | (value & (0xFFFFFFFFu >> (32 - bits)));
+               reg_bits += bits;
+               bits_left -= bits;
+               while (reg_bits >= 8)
+               {
+                  data[n++] = reg >> (reg_bits - 8);
+                  reg_bits -= 8;
+               }
+            }
+            // Last partial byte padded with zeros
+            if (reg_bits > 0)
+               data[n++] = reg << (8 - reg_bits);
+            return_buffer (context, returnv, (char *) data, n);
+         }
+      }
+      break;
    }
 }
 
@@ -554,4 +797,6 @@ void init_system_channels (const struct context_rmcios *context)
    create_channel_str (context, "int", (class_rmcios) int_class_func, 0);
    create_channel_str (context, "string", (class_rmcios) string_class_func, 0);
    create_channel_str (context, "chain", (class_rmcios) chain_class_func, 0);
+   create_channel_str (context, "binary", (class_rmcios) binary_class_func,
+                       0);
 }
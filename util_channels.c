@@ -29,6 +29,343 @@ along with RMCIOS.  If not, see <http://www.gnu.org/licenses/>.
 
 
 #include "RMCIOS-functions.h"
+#include "number_format.h"
+#include "byte_scan.h"
+
+/////////////////////////////////////////////////
+// Platform threads and clocks                 //
+/////////////////////////////////////////////////
+#if defined(_WIN32)
+#include <windows.h>
+#define UTIL_THREADS
+#define UTIL_CLOCK
+typedef HANDLE thread_handle;
+#define THREAD_FUNCTION(name, arg) static DWORD WINAPI name (LPVOID arg)
+
+static int thread_start (thread_handle * thread,
+                         LPTHREAD_START_ROUTINE function, void *arg)
+{
+   *thread = CreateThread (0, 0, function, arg, 0, 0);
+   return *thread != 0;
+}
+
+static void thread_join (thread_handle thread)
+{
+   WaitForSingleObject (thread, INFINITE);
+   CloseHandle (thread);
+}
+
+static int processor_count (void)
+{
+   SYSTEM_INFO info;
+   GetSystemInfo (&info);
+   return info.dwNumberOfProcessors;
+}
+
+static void thread_sleep (int milliseconds)
+{
+   Sleep (milliseconds);
+}
+
+// Auto reset event for waking a waiting thread
+typedef HANDLE thread_event;
+
+static int event_init (thread_event * event)
+{
+   *event = CreateEvent (0, FALSE, FALSE, 0);
+   return *event != 0;
+}
+
+static void event_signal (thread_event * event)
+{
+   SetEvent (*event);
+}
+
+static void event_wait (thread_event * event)
+{
+   WaitForSingleObject (*event, INFINITE);
+}
+
+static void event_destroy (thread_event * event)
+{
+   CloseHandle (*event);
+}
+
+// Monotonic clock in nanoseconds
+static long long clock_monotonic_ns (void)
+{
+   LARGE_INTEGER counter, frequency;
+   QueryPerformanceCounter (&counter);
+   QueryPerformanceFrequency (&frequency);
+   return counter.QuadPart / frequency.QuadPart * 1000000000LL
+      + counter.QuadPart % frequency.QuadPart * 1000000000LL
+      / frequency.QuadPart;
+}
+
+// Wall clock in nanoseconds since 1970-01-01 UTC
+static long long clock_wall_ns (void)
+{
+   FILETIME t;
+   long long ticks;
+   GetSystemTimeAsFileTime (&t);
+   // 100ns ticks since 1601-01-01
+   ticks = (long long) t.dwHighDateTime << 32 | t.dwLowDateTime;
+   return (ticks - 116444736000000000LL) * 100;
+}
+
+#elif defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+#define UTIL_THREADS
+#define UTIL_CLOCK
+typedef pthread_t thread_handle;
+#define THREAD_FUNCTION(name, arg) static void *name (void *arg)
+
+static int thread_start (thread_handle * thread,
+                         void *(*function) (void *), void *arg)
+{
+   return pthread_create (thread, 0, function, arg) == 0;
+}
+
+static void thread_join (thread_handle thread)
+{
+   pthread_join (thread, 0);
+}
+
+static int processor_count (void)
+{
+   return (int) sysconf (_SC_NPROCESSORS_ONLN);
+}
+
+static void thread_sleep (int milliseconds)
+{
+   usleep (milliseconds * 1000);
+}
+
+// Auto reset event for waking a waiting thread
+typedef struct
+{
+   pthread_mutex_t mutex;
+   pthread_cond_t cond;
+   int signaled;
+} thread_event;
+
+static int event_init (thread_event * event)
+{
+   event->signaled = 0;
+   if (pthread_mutex_init (&event->mutex, 0) != 0)
+      return 0;
+   if (pthread_cond_init (&event->cond, 0) != 0)
+   {
+      pthread_mutex_destroy (&event->mutex);
+      return 0;
+   }
+   return 1;
+}
+
+static void event_signal (thread_event * event)
+{
+   pthread_mutex_lock (&event->mutex);
+   event->signaled = 1;
+   pthread_cond_signal (&event->cond);
+   pthread_mutex_unlock (&event->mutex);
+}
+
+static void event_wait (thread_event * event)
+{
+   pthread_mutex_lock (&event->mutex);
+   while (!event->signaled)
+      pthread_cond_wait (&event->cond, &event->mutex);
+   event->signaled = 0;
+   pthread_mutex_unlock (&event->mutex);
+}
+
+static void event_destroy (thread_event * event)
+{
+   pthread_cond_destroy (&event->cond);
+   pthread_mutex_destroy (&event->mutex);
+}
+
+// Monotonic clock in nanoseconds
+static long long clock_monotonic_ns (void)
+{
+   struct timespec t;
+   clock_gettime (CLOCK_MONOTONIC, &t);
+   return t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+// Wall clock in nanoseconds since 1970-01-01 UTC
+static long long clock_wall_ns (void)
+{
+   struct timespec t;
+   clock_gettime (CLOCK_REALTIME, &t);
+   return t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+#endif
+
+/////////////////////////////////////////////////
+// Lock-free bounded multi producer queue      //
+// of variable length records.                 //
+/////////////////////////////////////////////////
+#if defined(UTIL_THREADS) && defined(__GNUC__)
+#define UTIL_QUEUE
+
+// Each slot carries a sequence number (D. Vyukov bounded queue).
+// sequence == position: slot is free for producer at position
+// sequence == position + 1: slot is published for consumer
+// Record takes consecutive slots. The first slot holds the length.
+#define QUEUE_SLOT_DATA 112
+
+struct queue_slot
+{
+   unsigned long sequence;
+   int length;                  // first slot: record length
+   int slots;                   // first slot: number of slots of record
+   char data[QUEUE_SLOT_DATA];
+};
+
+struct record_queue
+{
+   struct queue_slot *slots;
+   unsigned long mask;          // slot count - 1 (power of 2)
+   unsigned long enqueue;
+   unsigned long dequeue;
+};
+
+static int queue_init (const struct context_rmcios *context,
+                       struct record_queue *q, int slots)
+{
+   int count = 1;
+   int i;
+   while (count < slots)
+      count *= 2;
+   q->slots = (struct queue_slot *)
+      allocate_storage (context, count * sizeof (struct queue_slot), 0);
+   if (q->slots == 0)
+      return 0;
+   for (i = 0; i < count; i++)
+      q->slots[i].sequence = i;
+   q->mask = count - 1;
+   q->enqueue = 0;
+   q->dequeue = 0;
+   return 1;
+}
+
+// Largest record that fits to queue
+#define QUEUE_MAX_RECORD(q) ((int) ((q)->mask + 1) * QUEUE_SLOT_DATA)
+
+// Add record to queue. Returns 0 when queue is full.
+static int queue_push (struct record_queue *q, const char *data, int length)
+{
+   int n = (length + QUEUE_SLOT_DATA - 1) / QUEUE_SLOT_DATA;
+   unsigned long position;
+   int i;
+
+   if (n == 0)
+      n = 1;
+   for (;;)
+   {
+      long diff = 0;
+      position = __atomic_load_n (&q->enqueue, __ATOMIC_RELAXED);
+      // All slots must be free. Consumers may release records
+      // out of order.
+      for (i = 0; i < n; i++)
+      {
+         struct queue_slot *slot = q->slots + ((position + i) & q->mask);
+         diff = (long) (__atomic_load_n (&slot->sequence, __ATOMIC_ACQUIRE)
+                        - (position + i));
+         if (diff != 0)
+            break;
+      }
+      if (i < n)
+      {
+         if (diff < 0)
+            return 0;           // Full
+         continue;              // Other producer claimed the position
+      }
+      if (__atomic_compare_exchange_n (&q->enqueue, &position,
+                                       position + n, 0, __ATOMIC_RELAXED,
+                                       __ATOMIC_RELAXED))
+         break;
+   }
+
+   q->slots[position & q->mask].length = length;
+   q->slots[position & q->mask].slots = n;
+   for (i = 0; i < n; i++)
+   {
+      struct queue_slot *slot = q->slots + ((position + i) & q->mask);
+      int j, m = length < QUEUE_SLOT_DATA ? length : QUEUE_SLOT_DATA;
+      for (j = 0; j < m; j++)
+         slot->data[j] = data[j];
+      data += m;
+      length -= m;
+      __atomic_store_n (&slot->sequence, position + i + 1, __ATOMIC_RELEASE);
+   }
+   return 1;
+}
+
+// Claim the oldest published record. Returns the number of slots
+// or 0 when there is no complete record. Claimed record must be
+// released with queue_release.
+static int queue_claim (struct record_queue *q, unsigned long *claimed)
+{
+   for (;;)
+   {
+      unsigned long position = __atomic_load_n (&q->dequeue,
+                                                __ATOMIC_RELAXED);
+      struct queue_slot *slot = q->slots + (position & q->mask);
+      long diff = (long) (__atomic_load_n (&slot->sequence, __ATOMIC_ACQUIRE)
+                          - (position + 1));
+      int n;
+      if (diff < 0)
+         return 0;              // Empty or first slot not published
+      if (diff > 0)
+         continue;              // Other consumer claimed the position
+      n = slot->slots;
+      // Slots are published in order. Last slot completes the record.
+      slot = q->slots + ((position + n - 1) & q->mask);
+      if (__atomic_load_n (&slot->sequence, __ATOMIC_ACQUIRE)
+          != position + n)
+         return 0;
+      if (__atomic_compare_exchange_n (&q->dequeue, &position, position + n,
+                                       0, __ATOMIC_RELAXED,
+                                       __ATOMIC_RELAXED))
+      {
+         *claimed = position;
+         return n;
+      }
+   }
+}
+
+// Copy claimed record to data. Returns record length.
+static int queue_copy (const struct record_queue *q, unsigned long position,
+                       char *data)
+{
+   int length = q->slots[position & q->mask].length;
+   int i, j = 0;
+   for (i = 0; i < length; i++)
+   {
+      if (j == QUEUE_SLOT_DATA)
+      {
+         position++;
+         j = 0;
+      }
+      data[i] = q->slots[position & q->mask].data[j++];
+   }
+   return length;
+}
+
+// Give claimed slots back to producers
+static void queue_release (struct record_queue *q, unsigned long position,
+                           int n)
+{
+   int i;
+   for (i = 0; i < n; i++)
+      __atomic_store_n (&q->slots[(position + i) & q->mask].sequence,
+                        position + i + q->mask + 1, __ATOMIC_RELEASE);
+}
+#endif
 
 /////////////////////////////////////////////////
 //! Channel for logging data to linked channel //
@@ -40,8 +377,402 @@ struct logger_data
    int *log_channels;
    int num_logged;
    int newline;
+
+   // Record under construction. Sent as single write on reset_char.
+   char *record;
+   int record_length;
+   int record_size;
+   char reading;                // log channel values are being appended
+
+#ifdef UTIL_QUEUE
+   // Asynchronous mode. Writer thread sends queued records.
+   char async;
+   char overflow;               // LOGGER_BLOCK, LOGGER_DROP_OLDEST/NEWEST
+   char stop;
+   struct record_queue queue;
+   char *batch;                 // records combined for one write
+   thread_handle writer;
+   thread_event wakeup;         // signaled on push to idle writer
+   char sleeping;               // writer waits for wakeup
+   const struct context_rmcios *context;
+   int id;
+#endif
+   unsigned int dropped;        // records lost on full queue
+
+   // Record timestamp prefix. Formatted seconds are cached and
+   // sub-second digits are patched in for each record.
+   char timestamp;              // LOGGER_TIME_NONE/ISO/EPOCH/EPOCH_NS
+   char digits;                 // sub-second digits
+   long long clock_offset;      // wall clock - monotonic clock
+   long long cached_second;
+   char prefix[40];
+   int prefix_seconds;          // length of seconds part in prefix
+
+   // Formatting of int and float values
+   signed char precision;       // decimals, -1 for shortest
+   char width;                  // minimum field width
 };
 
+#define LOGGER_TIME_NONE 0
+#define LOGGER_TIME_ISO 1
+#define LOGGER_TIME_EPOCH 2
+#define LOGGER_TIME_EPOCH_NS 3
+
+#define LOGGER_BLOCK 0
+#define LOGGER_DROP_OLDEST 1
+#define LOGGER_DROP_NEWEST 2
+
+#define LOGGER_RECORD_SIZE 128
+#define LOGGER_MAX_WIDTH 32
+#define LOGGER_NUMBER_SIZE (NUMBER_FORMAT_SIZE + LOGGER_MAX_WIDTH)
+
+#ifdef UTIL_QUEUE
+// Send queued records to linked channels. Records are collected to
+// batch so that one write can carry many records.
+THREAD_FUNCTION (logger_writer_thread, arg)
+{
+   struct logger_data *this = (struct logger_data *) arg;
+   struct record_queue *q = &this->queue;
+   for (;;)
+   {
+      int length = 0;
+      unsigned long position;
+      int n;
+      while ((n = queue_claim (q, &position)) > 0)
+      {
+         if (length + q->slots[position & q->mask].length
+             > QUEUE_MAX_RECORD (q))
+         {
+            write_buffer (this->context,
+                          linked_channels (this->context, this->id),
+                          this->batch, length, 0);
+            length = 0;
+         }
+         length += queue_copy (q, position, this->batch + length);
+         queue_release (q, position, n);
+      }
+      if (length > 0)
+         write_buffer (this->context,
+                       linked_channels (this->context, this->id),
+                       this->batch, length, 0);
+      else if (__atomic_load_n (&this->stop, __ATOMIC_ACQUIRE))
+         break;
+      else
+      {
+         // Sleep until producer pushes. Producer checks sleeping after
+         // push and writer checks queue after setting sleeping, so
+         // either one sees the other.
+         __atomic_store_n (&this->sleeping, 1, __ATOMIC_SEQ_CST);
+         __atomic_thread_fence (__ATOMIC_SEQ_CST);
+         if (__atomic_load_n (&q->enqueue, __ATOMIC_SEQ_CST)
+             == __atomic_load_n (&q->dequeue, __ATOMIC_SEQ_CST)
+             && !__atomic_load_n (&this->stop, __ATOMIC_ACQUIRE))
+            event_wait (&this->wakeup);
+         __atomic_store_n (&this->sleeping, 0, __ATOMIC_SEQ_CST);
+      }
+   }
+   return 0;
+}
+
+// Wake writer thread if it is waiting
+static void logger_wake (struct logger_data *this)
+{
+   __atomic_thread_fence (__ATOMIC_SEQ_CST);
+   if (__atomic_load_n (&this->sleeping, __ATOMIC_SEQ_CST)
+       && __atomic_exchange_n (&this->sleeping, 0, __ATOMIC_SEQ_CST))
+      event_signal (&this->wakeup);
+}
+
+static void logger_queue (struct logger_data *this,
+                          const char *data, int length)
+{
+   if (length > QUEUE_MAX_RECORD (&this->queue))
+   {
+      __atomic_add_fetch (&this->dropped, 1, __ATOMIC_RELAXED);
+      return;
+   }
+   while (queue_push (&this->queue, data, length) == 0)
+   {
+      logger_wake (this);
+      unsigned long position;
+      int n;
+      switch (this->overflow)
+      {
+      case LOGGER_DROP_NEWEST:
+         __atomic_add_fetch (&this->dropped, 1, __ATOMIC_RELAXED);
+         return;
+
+      case LOGGER_DROP_OLDEST:
+         n = queue_claim (&this->queue, &position);
+         if (n > 0)
+         {
+            queue_release (&this->queue, position, n);
+            __atomic_add_fetch (&this->dropped, 1, __ATOMIC_RELAXED);
+            break;
+         }
+         // Oldest record is still being written.
+         thread_sleep (0);
+         break;
+
+      default:
+         // Wait for writer thread
+         thread_sleep (0);
+         break;
+      }
+   }
+   logger_wake (this);
+}
+
+// Stop writer thread after queued records are written
+static void logger_stop (const struct context_rmcios *context,
+                         struct logger_data *this)
+{
+   if (this->async == 0)
+      return;
+   __atomic_store_n (&this->stop, 1, __ATOMIC_RELEASE);
+   event_signal (&this->wakeup);
+   thread_join (this->writer);
+   event_destroy (&this->wakeup);
+   free_storage (context, this->queue.slots, 0);
+   free_storage (context, this->batch, 0);
+   this->async = 0;
+}
+
+static void logger_start (const struct context_rmcios *context, int id,
+                          struct logger_data *this, int slots)
+{
+   if (queue_init (context, &this->queue, slots) == 0)
+      return;
+   this->batch = (char *)
+      allocate_storage (context, QUEUE_MAX_RECORD (&this->queue), 0);
+   this->context = context;
+   this->id = id;
+   this->stop = 0;
+   this->sleeping = 0;
+   if (this->batch != 0 && event_init (&this->wakeup))
+   {
+      if (thread_start (&this->writer, logger_writer_thread, this))
+      {
+         this->async = 1;
+         return;
+      }
+      event_destroy (&this->wakeup);
+   }
+   if (this->batch != 0)
+      free_storage (context, this->batch, 0);
+   free_storage (context, this->queue.slots, 0);
+}
+#endif
+
+// Compare setup keyword. Returns nonzero when s equals keyword.
+static int util_keyword (const char *s, const char *keyword)
+{
+   while (*keyword != 0 && *s == *keyword)
+   {
+      s++;
+      keyword++;
+   }
+   return *s == 0 && *keyword == 0;
+}
+
+// Format int or float parameter to s. s must fit LOGGER_NUMBER_SIZE.
+static int logger_number (struct logger_data *this,
+                          enum type_rmcios paramtype,
+                          const union param_rmcios param, char *s)
+{
+   if (paramtype == float_rmcios)
+      return format_float (s, param.fv[0], this->precision, this->width);
+   return format_int (s, param.iv[0], this->width, ' ');
+}
+
+// Send data to linked channels
+static void logger_output (const struct context_rmcios *context, int id,
+                           struct logger_data *this,
+                           const char *data, int length)
+{
+#ifdef UTIL_QUEUE
+   if (this->async)
+   {
+      logger_queue (this, data, length);
+      return;
+   }
+#endif
+   write_buffer (context, linked_channels (context, id), data, length, 0);
+}
+
+// Send the record to linked channels and start new record
+static void logger_emit (const struct context_rmcios *context, int id,
+                         struct logger_data *this)
+{
+   if (this->record_length > 0)
+      logger_output (context, id, this, this->record, this->record_length);
+   this->record_length = 0;
+}
+
+static void logger_append (const struct context_rmcios *context, int id,
+                           struct logger_data *this,
+                           const char *data, int length)
+{
+   int i;
+   if (this->record_length + length > this->record_size)
+   {
+      // Grow the record buffer
+      int size = this->record_size * 2;
+      char *record;
+      if (size < LOGGER_RECORD_SIZE)
+         size = LOGGER_RECORD_SIZE;
+      while (size < this->record_length + length)
+         size *= 2;
+      record = (char *) allocate_storage (context, size, 0);
+      if (record == 0)
+      {
+         // Out of memory. Pass data through unbuffered.
+         logger_emit (context, id, this);
+         logger_output (context, id, this, data, length);
+         return;
+      }
+      for (i = 0; i < this->record_length; i++)
+         record[i] = this->record[i];
+      if (this->record != 0)
+         free_storage (context, this->record, 0);
+      this->record = record;
+      this->record_size = size;
+   }
+   for (i = 0; i < length; i++)
+      this->record[this->record_length + i] = data[i];
+   this->record_length += length;
+}
+
+#ifdef UTIL_CLOCK
+// Write value as fixed number of decimal digits
+static void logger_digits (char *s, long long value, int digits)
+{
+   while (digits-- > 0)
+   {
+      s[digits] = '0' + (char) (value % 10);
+      value /= 10;
+   }
+}
+
+// Format seconds part of timestamp prefix
+static void logger_format_second (struct logger_data *this,
+                                  long long second)
+{
+   char *s = this->prefix;
+   if (this->timestamp == LOGGER_TIME_ISO)
+   {
+      // Civil date from days since 1970 (H. Hinnant)
+      long long days = second / 86400;
+      int t = (int) (second - days * 86400);
+      long long z, era, doe, yoe, doy, mp, y, m, d;
+      if (t < 0)
+      {
+         t += 86400;
+         days--;
+      }
+      z = days + 719468;
+      era = (z >= 0 ? z : z - 146096) / 146097;
+      doe = z - era * 146097;
+      yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+      doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+      mp = (5 * doy + 2) / 153;
+      d = doy - (153 * mp + 2) / 5 + 1;
+      m = mp < 10 ? mp + 3 : mp - 9;
+      y = yoe + era * 400 + (m <= 2);
+
+      logger_digits (s, y, 4);
+      s[4] = '-';
+      logger_digits (s + 5, m, 2);
+      s[7] = '-';
+      logger_digits (s + 8, d, 2);
+      s[10] = 'T';
+      logger_digits (s + 11, t / 3600, 2);
+      s[13] = ':';
+      logger_digits (s + 14, t / 60 % 60, 2);
+      s[16] = ':';
+      logger_digits (s + 17, t % 60, 2);
+      this->prefix_seconds = 19;
+   }
+   else
+   {
+      long long v;
+      int n = 1;
+      for (v = second; v >= 10; v /= 10)
+         n++;
+      logger_digits (s, second, n);
+      this->prefix_seconds = n;
+   }
+   this->cached_second = second;
+}
+
+// Format timestamp of current time. Returns prefix length.
+static int logger_format_timestamp (struct logger_data *this)
+{
+   long long now = clock_monotonic_ns () + this->clock_offset;
+   long long second = now / 1000000000;
+   int length;
+   int nanoseconds = (int) (now - second * 1000000000);
+   if (second != this->cached_second)
+      logger_format_second (this, second);
+
+   length = this->prefix_seconds;
+   if (this->timestamp == LOGGER_TIME_EPOCH_NS)
+   {
+      logger_digits (this->prefix + length, nanoseconds, 9);
+      return length + 9;
+   }
+   if (this->digits > 0)
+   {
+      int i, fraction = nanoseconds;
+      for (i = this->digits; i < 9; i++)
+         fraction /= 10;
+      this->prefix[length++] = '.';
+      logger_digits (this->prefix + length, fraction, this->digits);
+      length += this->digits;
+   }
+   if (this->timestamp == LOGGER_TIME_ISO)
+      this->prefix[length++] = 'Z';
+   return length;
+}
+#endif
+
+// Append values of log channels to the record. Values are returned
+// to this channel and appended by the write handler.
+static void logger_append_channels (const struct context_rmcios *context,
+                                    int id, struct logger_data *this,
+                                    int trailing_delimiter)
+{
+   int j;
+#ifdef UTIL_CLOCK
+   if (this->timestamp != LOGGER_TIME_NONE)
+   {
+      logger_append (context, id, this, this->prefix,
+                     logger_format_timestamp (this));
+      if (trailing_delimiter || this->num_logged > 0)
+         logger_append (context, id, this, &this->delimiter_char, 1);
+   }
+#endif
+   for (j = 0; j < this->num_logged; j++)
+   {
+      struct combo_rmcios destination = {
+         .paramtype = channel_rmcios,
+         .num_params = 1,
+         .param.channel = id
+      };
+
+      this->reading = 1;
+      run_channel (context, this->log_channels[j],
+                            read_rmcios,
+                            channel_rmcios,
+                            &destination, 0,
+                            (const union param_rmcios) 0);
+      this->reading = 0;
+
+      if (trailing_delimiter || j < this->num_logged - 1)
+         logger_append (context, id, this, &this->delimiter_char, 1);
+   }
+}
+
 void logger_class_func (struct logger_data *this,
                         const struct context_rmcios *context, int id,
                         enum function_rmcios function,
@@ -49,7 +780,6 @@ void logger_class_func (struct logger_data *this,
                         struct combo_rmcios *returnv,
                         int num_params, const union param_rmcios param)
 {
-   int pstrlen;
    switch (function)
    {
    case help_rmcios:
@@ -62,6 +792,29 @@ void logger_class_func (struct logger_data *this,
               "write newname data # write data to output channel.\r\n"
               "      On reset_char found: "
               "inserts output channels just before next character.\r\n"
+              "      Each record up to reset_char is written"
+              " to output channel as single write.\r\n"
+              "setup newname async slots(256) | overflow(block)\r\n"
+              "  -Queue records and write them from background thread.\r\n"
+              "  -slots: queue size in 112 byte slots\r\n"
+              "  -overflow on full queue: block, drop_oldest or"
+              " drop_newest\r\n"
+              "  -Output channels are written from the background"
+              " thread. They must not be\r\n"
+              "   used from any other thread or channel"
+              " while async mode is on.\r\n"
+              "setup newname sync\r\n"
+              "  -Write queued records and return to synchronous"
+              " writes\r\n"
+              "setup newname timestamp format(iso) | digits(3)\r\n"
+              "  -Start records with timestamp. format: iso, epoch,"
+              " epoch_ns or none\r\n"
+              "  -digits: sub-second digits of iso and epoch (0-9)\r\n"
+              "setup newname numbers precision(-1) | width(0)\r\n"
+              "  -Format of int and float values."
+              " precision: decimals, -1 for shortest\r\n"
+              "  -width: minimum width of value (0-32)\r\n"
+              "read newname # number of dropped records\r\n"
               "link newname output_channel "
               " # link logger output to channel\r\n");
       break;
@@ -71,11 +824,29 @@ void logger_class_func (struct logger_data *this,
       // allocate new data
       this = (struct logger_data *) 
              allocate_storage (context, sizeof (struct logger_data), 0); 
+      if (this == 0)
+         break;
       this->reset_char = '\n';
       this->delimiter_char = ' ';
       this->log_channels = 0;
       this->newline = 1;
       this->num_logged = 0;
+      this->record = 0;
+      this->record_length = 0;
+      this->record_size = 0;
+      this->reading = 0;
+      this->dropped = 0;
+      this->timestamp = LOGGER_TIME_NONE;
+      this->digits = 3;
+      this->clock_offset = 0;
+      this->cached_second = -1;
+      this->prefix_seconds = 0;
+      this->precision = -1;
+      this->width = 0;
+#ifdef UTIL_QUEUE
+      this->async = 0;
+      this->overflow = LOGGER_BLOCK;
+#endif
 
       // create channel
       create_channel_param (context, paramtype, param, 0, 
@@ -87,6 +858,90 @@ void logger_class_func (struct logger_data *this,
       {
          break;
       }
+      if (num_params < 1)
+         break;
+      {
+         int slen = param_string_alloc_size (context, paramtype, param, 0);
+         char buffer[slen];
+         const char *mode;
+         mode = param_to_string (context, paramtype, param, 0, slen, buffer);
+         if (util_keyword (mode, "numbers"))
+         {
+            int precision = -1, width = 0;
+            if (num_params >= 2)
+               precision = param_to_int (context, paramtype, param, 1);
+            if (num_params >= 3)
+               width = param_to_int (context, paramtype, param, 2);
+            this->precision = precision < 0 ? -1 : precision > 9 ? 9
+                                                 : precision;
+            this->width = width < 0 ? 0 : width > LOGGER_MAX_WIDTH
+                                        ? LOGGER_MAX_WIDTH : width;
+            break;
+         }
+#ifdef UTIL_CLOCK
+         if (util_keyword (mode, "timestamp"))
+         {
+            this->timestamp = LOGGER_TIME_ISO;
+            if (num_params >= 2)
+            {
+               int flen = param_string_alloc_size (context, paramtype,
+                                                   param, 1);
+               char fbuffer[flen];
+               const char *format;
+               format = param_to_string (context, paramtype, param, 1,
+                                         flen, fbuffer);
+               if (util_keyword (format, "epoch"))
+                  this->timestamp = LOGGER_TIME_EPOCH;
+               else if (util_keyword (format, "epoch_ns"))
+                  this->timestamp = LOGGER_TIME_EPOCH_NS;
+               else if (util_keyword (format, "none"))
+                  this->timestamp = LOGGER_TIME_NONE;
+            }
+            if (num_params >= 3)
+            {
+               int digits = param_to_int (context, paramtype, param, 2);
+               this->digits = digits < 0 ? 0 : digits > 9 ? 9 : digits;
+            }
+            // Map monotonic clock to wall clock time
+            this->clock_offset = clock_wall_ns () - clock_monotonic_ns ();
+            this->cached_second = -1;
+            break;
+         }
+#endif
+#ifdef UTIL_QUEUE
+         if (util_keyword (mode, "async"))
+         {
+            int slots = 256;
+            if (num_params >= 2)
+               slots = param_to_int (context, paramtype, param, 1);
+            if (slots < 1)
+               slots = 1;
+            if (num_params >= 3)
+            {
+               int olen = param_string_alloc_size (context, paramtype,
+                                                   param, 2);
+               char obuffer[olen];
+               const char *overflow;
+               overflow = param_to_string (context, paramtype, param, 2,
+                                           olen, obuffer);
+               if (util_keyword (overflow, "drop_oldest"))
+                  this->overflow = LOGGER_DROP_OLDEST;
+               else if (util_keyword (overflow, "drop_newest"))
+                  this->overflow = LOGGER_DROP_NEWEST;
+               else
+                  this->overflow = LOGGER_BLOCK;
+            }
+            logger_stop (context, this);
+            logger_start (context, id, this, slots);
+            break;
+         }
+         if (util_keyword (mode, "sync"))
+         {
+            logger_stop (context, this);
+            break;
+         }
+#endif
+      }
       if (num_params < 3)
          break;
       {
@@ -113,101 +968,347 @@ void logger_class_func (struct logger_data *this,
       {
          break;
       }
-      if (num_params < 1)       
-      // direct trigger of log action
+      if (this->reading)
+      // value of log channel
       {
-         char wstr[2] = { 0 };
-         int j;
-         for (j = 0; j < this->num_logged; j++)
-         {
-            struct combo_rmcios destination = {
-               .paramtype = channel_rmcios,
-               .num_params = 1,
-               .param.channel = linked_channels (context, id)
-            };
-            
-            run_channel (context, this->log_channels[j],
-                                  read_rmcios,
-                                  channel_rmcios,
-                                  &destination, 0,
-                                  (const union param_rmcios) 0);
-
-            if (j < this->num_logged - 1)
-            {
-               wstr[0] = this->delimiter_char;
-               // add delimiter
-               write_str (context, linked_channels (context, id), wstr, 0); 
-            }
+         int plen;
+         if (num_params < 1)
+            break;
+         if (paramtype == float_rmcios || paramtype == int_rmcios)
+         {
+            char s[LOGGER_NUMBER_SIZE];
+            logger_append (context, id, this, s,
+                           logger_number (this, paramtype, param, s));
+            break;
+         }
+         plen = param_buffer_alloc_size (context, paramtype, param, 0);
+         {
+            char buffer[plen];
+            struct buffer_rmcios p;
+            p = param_to_buffer (context, paramtype, param, 0, plen, buffer);
+            logger_append (context, id, this, p.data, p.length);
          }
-         wstr[0] = this->reset_char;
-         // add end of line (reset char) 
-         write_str (context, linked_channels (context, id), wstr, 0);   
          break;
       }
-
-      pstrlen = param_string_alloc_size (context, paramtype, param, 0);
+      if (num_params < 1)       
+      // direct trigger of log action
+      {
+         logger_append_channels (context, id, this, 0);
+         // add end of line (reset char) 
+         logger_append (context, id, this, &this->reset_char, 1);
+         logger_emit (context, id, this);
+         break;
+      }
+
       {
-         int j;
-         char wstr[2] = { 0 };
-         char str[pstrlen];
+         int plen = param_buffer_alloc_size (context, paramtype, param, 0);
+         char buffer[paramtype == buffer_rmcios ? 1 : plen];
+         char number[LOGGER_NUMBER_SIZE];
+         struct buffer_rmcios p;
          const char *s;
-         s = param_to_string (context, paramtype, param, 0, pstrlen, str);
-         while (*s != 0)
+         int length;
+
+         if (paramtype == buffer_rmcios)
+            p = param.bv[0];
+         else if (paramtype == float_rmcios || paramtype == int_rmcios)
          {
-            if (*s
-                  == 0)
-               break;
+            p.data = number;
+            p.length = logger_number (this, paramtype, param, number);
+         }
+         else
+            p = param_to_buffer (context, paramtype, param, 0, plen, buffer);
+         s = p.data;
+         length = p.length;
 
+         while (length > 0)
+         {
+            int n;
             if (this->newline == 1 && *s != this->reset_char)   
             // trigger channels
             {
-               for (j = 0; j < this->num_logged; j++)
-               {
-                  struct combo_rmcios destination = {
-                     .paramtype = channel_rmcios,
-                     .num_params = 1,
-                     .param.channel = linked_channels (context, id)
-                  };
-
-                  run_channel (context,
-                                        this->log_channels[j],
-                                        read_rmcios,
-                                        channel_rmcios,
-                                        &destination, 
-                                        0,
-                                        (const union param_rmcios) 0);
-
-                  wstr[0] = this->delimiter_char;
-                  // add delimiter
-                  write_str (context, linked_channels (context, id), wstr, 0);  
-               }
-
+               logger_append_channels (context, id, this, 1);
                this->newline = 0;
             }
-            wstr[0] = *s;
 
-            if (*s == this->reset_char)
+            n = scan_bytes ((const unsigned char *) s, length,
+                           this->reset_char, this->reset_char);
+            if (n == length)
             {
-               // newline -> next input character will trigger log entry.
-               this->newline = 1;       
+               // Partial record continues on next write
+               logger_append (context, id, this, s, n);
+               break;
             }
-            write_str (context, linked_channels (context, id), wstr, 0);
-            s++;
+            // newline -> next input character will trigger log entry.
+            logger_append (context, id, this, s, n + 1);
+            logger_emit (context, id, this);
+            this->newline = 1;       
+            s += n + 1;
+            length -= n + 1;
          }
       }
       break;
+
+   case read_rmcios:
+      if (this == 0)
+         break;
+      return_int (context, returnv, this->dropped);
+      break;
    }
 }
 
 /////////////////////////////////////////////////////////////
-// Channel to calculate two's complement checksums.
+// Channel to calculate modular and position dependent checksums.
 /////////////////////////////////////////////////////////////
+enum checksum_algorithm
+{
+   CHECKSUM_SUM8,               // 8bit sum, sent as two's complement int
+   CHECKSUM_SUM16,
+   CHECKSUM_SUM32,
+   CHECKSUM_LRC,                // two's complement of 8bit sum
+   CHECKSUM_XOR,
+   CHECKSUM_FLETCHER16,
+   CHECKSUM_FLETCHER32,         // over little endian 16bit words
+   CHECKSUM_ADLER32
+};
+
+static const char *checksum_names[] = {
+   "sum8", "sum16", "sum32", "lrc", "xor",
+   "fletcher16", "fletcher32", "adler32", 0
+};
+
+static const char checksum_bytes[] = { 1, 2, 4, 1, 1, 2, 4, 4 };
+
 struct checksum_data
 {
-   unsigned char checksum;
+   enum checksum_algorithm algorithm;
+   char big_endian;             // output byte order
+   unsigned int a;              // sum / first Fletcher sum
+   unsigned int b;              // second Fletcher sum
+   int odd;                     // Fletcher-32 byte waiting for pair
 };
 
-// Should later be upgraded to handle multiple byte checksums with variying byte orderings.
+// Blocks that can be summed before reduction without 32bit overflow
+#define CHECKSUM_NMAX 5552
+#define CHECKSUM_NMAX_WORDS 359
+
+static unsigned long long checksum_load (const unsigned char *p)
+{
+   return (unsigned long long) p[0] | (unsigned long long) p[1] << 8
+      | (unsigned long long) p[2] << 16 | (unsigned long long) p[3] << 24
+      | (unsigned long long) p[4] << 32 | (unsigned long long) p[5] << 40
+      | (unsigned long long) p[6] << 48 | (unsigned long long) p[7] << 56;
+}
+
+// Sum of bytes. 8 bytes are added at a time to four 16bit lanes.
+static unsigned int checksum_sum (const unsigned char *data, int length)
+{
+   const unsigned long long mask = 0x00FF00FF00FF00FFULL;
+   unsigned int sum = 0;
+   while (length >= 8)
+   {
+      unsigned long long lanes = 0;
+      int n = length / 8;
+      if (n > 128)
+         n = 128;               // Lanes can take 128 * 2 * 255
+      length -= n * 8;
+      while (n-- > 0)
+      {
+         unsigned long long word = checksum_load (data);
+         lanes += (word & mask) + ((word >> 8) & mask);
+         data += 8;
+      }
+      lanes = (lanes & 0x0000FFFF0000FFFFULL)
+         + ((lanes >> 16) & 0x0000FFFF0000FFFFULL);
+      sum += (unsigned int) (lanes + (lanes >> 32));
+   }
+   while (length-- > 0)
+      sum += *data++;
+   return sum;
+}
+
+static unsigned int checksum_xor (const unsigned char *data, int length)
+{
+   unsigned long long x = 0;
+   while (length >= 8)
+   {
+      x ^= checksum_load (data);
+      data += 8;
+      length -= 8;
+   }
+   while (length-- > 0)
+      x ^= *data++;
+   x ^= x >> 32;
+   x ^= x >> 16;
+   x ^= x >> 8;
+   return (unsigned int) x & 0xFF;
+}
+
+// Fletcher-16 and Adler-32 byte sums. Modulo is taken once per block.
+static void checksum_fletcher (unsigned int *a, unsigned int *b,
+                               unsigned int modulus,
+                               const unsigned char *data, int length)
+{
+   unsigned int s1 = *a;
+   unsigned int s2 = *b;
+   while (length > 0)
+   {
+      int n = length < CHECKSUM_NMAX ? length : CHECKSUM_NMAX;
+      length -= n;
+      for (; n >= 8; n -= 8)
+      {
+         s1 += data[0];
+         s2 += s1;
+         s1 += data[1];
+         s2 += s1;
+         s1 += data[2];
+         s2 += s1;
+         s1 += data[3];
+         s2 += s1;
+         s1 += data[4];
+         s2 += s1;
+         s1 += data[5];
+         s2 += s1;
+         s1 += data[6];
+         s2 += s1;
+         s1 += data[7];
+         s2 += s1;
+         data += 8;
+      }
+      while (n-- > 0)
+      {
+         s1 += *data++;
+         s2 += s1;
+      }
+      s1 %= modulus;
+      s2 %= modulus;
+   }
+   *a = s1;
+   *b = s2;
+}
+
+// Fletcher-32 sums of 16bit words
+static void checksum_fletcher32 (unsigned int *a, unsigned int *b,
+                                 const unsigned char *data, int words)
+{
+   unsigned int s1 = *a;
+   unsigned int s2 = *b;
+   while (words > 0)
+   {
+      int n = words < CHECKSUM_NMAX_WORDS ? words : CHECKSUM_NMAX_WORDS;
+      words -= n;
+      while (n-- > 0)
+      {
+         s1 += data[0] | data[1] << 8;
+         s2 += s1;
+         data += 2;
+      }
+      s1 %= 65535;
+      s2 %= 65535;
+   }
+   *a = s1;
+   *b = s2;
+}
+
+static void checksum_update (struct checksum_data *this,
+                             const unsigned char *data, int length)
+{
+   switch (this->algorithm)
+   {
+   case CHECKSUM_SUM8:
+   case CHECKSUM_SUM16:
+   case CHECKSUM_SUM32:
+   case CHECKSUM_LRC:
+      this->a += checksum_sum (data, length);
+      break;
+
+   case CHECKSUM_XOR:
+      this->a ^= checksum_xor (data, length);
+      break;
+
+   case CHECKSUM_FLETCHER16:
+      checksum_fletcher (&this->a, &this->b, 255, data, length);
+      break;
+
+   case CHECKSUM_ADLER32:
+      checksum_fletcher (&this->a, &this->b, 65521, data, length);
+      break;
+
+   case CHECKSUM_FLETCHER32:
+      if (length > 0 && this->odd >= 0)
+      {
+         unsigned char word[2];
+         word[0] = (unsigned char) this->odd;
+         word[1] = *data++;
+         length--;
+         checksum_fletcher32 (&this->a, &this->b, word, 1);
+         this->odd = -1;
+      }
+      checksum_fletcher32 (&this->a, &this->b, data, length / 2);
+      if (length & 1)
+         this->odd = data[length - 1];
+      break;
+   }
+}
+
+static unsigned int checksum_value (const struct checksum_data *this)
+{
+   switch (this->algorithm)
+   {
+   case CHECKSUM_SUM8:
+   case CHECKSUM_XOR:
+      return this->a & 0xFF;
+   case CHECKSUM_SUM16:
+      return this->a & 0xFFFF;
+   case CHECKSUM_LRC:
+      return (0 - this->a) & 0xFF;
+   case CHECKSUM_FLETCHER16:
+      return (this->b % 255) << 8 | (this->a % 255);
+   case CHECKSUM_FLETCHER32:
+      if (this->odd >= 0)
+      {
+         // Pad the last byte with zero
+         unsigned int a = (this->a + this->odd) % 65535;
+         unsigned int b = (this->b + a) % 65535;
+         return b << 16 | a;
+      }
+      return this->b << 16 | this->a;
+   case CHECKSUM_ADLER32:
+      return this->b << 16 | this->a;
+   default:
+      return this->a;
+   }
+}
+
+// Set the checksum value. Inverse of checksum_value.
+static void checksum_set (struct checksum_data *this, unsigned int value)
+{
+   this->odd = -1;
+   this->b = 0;
+   switch (this->algorithm)
+   {
+   case CHECKSUM_LRC:
+      this->a = (0 - value) & 0xFF;
+      break;
+   case CHECKSUM_FLETCHER16:
+      this->a = (value & 0xFF) % 255;
+      this->b = ((value >> 8) & 0xFF) % 255;
+      break;
+   case CHECKSUM_FLETCHER32:
+   case CHECKSUM_ADLER32:
+      this->a = value & 0xFFFF;
+      this->b = value >> 16;
+      break;
+   default:
+      this->a = value;
+      break;
+   }
+}
+
+static void checksum_reset (struct checksum_data *this)
+{
+   checksum_set (this, this->algorithm == CHECKSUM_ADLER32 ? 1 : 0);
+}
+
 void checksum_class_func (struct checksum_data *this,
                           const struct context_rmcios *context, int id,
                           enum function_rmcios function,
@@ -220,21 +1321,32 @@ void checksum_class_func (struct checksum_data *this,
    case help_rmcios:
       return_string (context, returnv,
                      "Checksum channel -"
-                     " channel for creating and checking 8bit two's complement"
-                     " modular checksums.\r\n"
-                     "create checksum newname\r\n"
-                     "setup newname sum\r\n"
+                     " channel for creating and checking modular"
+                     " checksums.\r\n"
+                     "create modsum newname\r\n"
+                     "setup newname sum | algorithm(sum8)"
+                     " | byte_order(big)\r\n"
                      "  -Set the stored sum\r\n"
+                     "  -algorithm: sum8 sum16 sum32 lrc xor fletcher16"
+                     " fletcher32 adler32\r\n"
+                     "  -byte_order: big or little."
+                     " Output byte order of the checksum.\r\n"
+                     "  -fletcher32 sums little endian 16bit words\r\n"
+                     "setup newname\r\n"
+                     "  -Reset the sum (adler32 starts from 1)\r\n"
                      "write newname data\r\n"
                      "  -Sum the data in buffer form to the checksum\r\n"
                      "write newname\r\n"
-                     "  -Sends checksum in inverted form to linked channels.\r\n"
-                     "  -Set the stored sum to 0\r\n"
+                     "  -sum8: Sends checksum in inverted form"
+                     " to linked channels.\r\n"
+                     "  -others: Sends checksum bytes to linked channels.\r\n"
+                     "  -Reset the sum\r\n"
                      "read newname\r\n"
                      "  -Returns stored checksum\r\n"
                      "  -Tests the stored checksum for 0."
                      " If true makes empty write to linked channels.\r\n"
                      "link newname channel\r\n");
+      break;
 
    case create_rmcios:
       if (num_params < 1)
@@ -245,7 +1357,9 @@ void checksum_class_func (struct checksum_data *this,
 
       if (this == 0)
          break;
-      this->checksum = 0;
+      this->algorithm = CHECKSUM_SUM8;
+      this->big_endian = 1;
+      checksum_reset (this);
 
       // create the channel
       create_channel_param (context, paramtype, param, 0, 
@@ -255,20 +1369,69 @@ void checksum_class_func (struct checksum_data *this,
    case setup_rmcios:
       if (this == 0)
          break;
-      if (num_params < 0)
-         break;
-      this->checksum = param_to_int (context, paramtype, param, 0);
+      if (num_params >= 2)
+      {
+         int slen = param_string_alloc_size (context, paramtype, param, 1);
+         char buffer[slen];
+         const char *name;
+         int i, j;
+         name = param_to_string (context, paramtype, param, 1, slen, buffer);
+         for (i = 0; checksum_names[i] != 0; i++)
+         {
+            for (j = 0; name[j] == checksum_names[i][j] && name[j] != 0; j++);
+            if (name[j] == checksum_names[i][j])
+            {
+               this->algorithm = (enum checksum_algorithm) i;
+               break;
+            }
+         }
+      }
+      if (num_params >= 3)
+      {
+         int slen = param_string_alloc_size (context, paramtype, param, 2);
+         char buffer[slen];
+         const char *order;
+         order = param_to_string (context, paramtype, param, 2, slen, buffer);
+         this->big_endian = (order[0] != 'l' && order[0] != 'L');
+      }
+      if (num_params < 1)
+         checksum_reset (this);
+      else
+         checksum_set (this, param_to_int (context, paramtype, param, 0));
       break;
 
    case write_rmcios:
       if (this == 0)
          break;
       if (num_params < 1)       
-      // Send checksum in two's complement to linked channels
       {
-         write_i (context, linked_channels (context, id),
-                  (~this->checksum) + 1);
-         this->checksum = 0;
+         unsigned int value = checksum_value (this);
+         if (this->algorithm == CHECKSUM_SUM8)
+         {
+            // Send checksum in two's complement to linked channels
+            write_i (context, linked_channels (context, id),
+                     (~(unsigned char) value) + 1);
+         }
+         else
+         {
+            // Send checksum bytes in configured byte order
+            char bytes[4];
+            int n = checksum_bytes[this->algorithm];
+            int i;
+            for (i = 0; i < n; i++)
+               bytes[this->big_endian ? n - 1 - i : i] =
+                  (char) (value >> (8 * i));
+            write_binary (context, linked_channels (context, id),
+                          bytes, n, 0, 0);
+         }
+         return_int (context, returnv, value);
+         checksum_reset (this);
+      }
+      else if (paramtype == buffer_rmcios)
+      {
+         // Sum directly from the parameter buffer
+         checksum_update (this, (const unsigned char *) param.bv[0].data,
+                          param.bv[0].length);
       }
       else      
       // Sum the parameter in buffer form.
@@ -280,16 +1443,12 @@ void checksum_class_func (struct checksum_data *this,
             char buffer[plen];  
             // Structure for handling the parameter data in buffer form.
             struct buffer_rmcios buf;   
-            int i;
 
             // Get the struct pointing to the parameter buffer:
             buf = param_to_buffer (context, paramtype, param, 0, plen, buffer);
 
-            // Sum the bytes
-            for (i = 0; i < buf.length; i++)
-            {
-               this->checksum += (unsigned char) buf.data[i];
-            }
+            checksum_update (this, (const unsigned char *) buf.data,
+                             buf.length);
          }
       }
       break;
@@ -298,10 +1457,10 @@ void checksum_class_func (struct checksum_data *this,
       if (this == 0)
          break;
       // Return the stored checksum
-      return_int (context, returnv, this->checksum);
+      return_int (context, returnv, checksum_value (this));
       // Send reset command (empty write) to linked channels
       // when checksum is correct(0) 
-      if (this->checksum == 0)
+      if (checksum_value (this) == 0)
          write_fv (context, linked_channels (context, id), 0, 0);
       break;
    }
@@ -384,7 +1543,11 @@ void lcg_random_class_func (struct lcg_data *this,
    case write_rmcios:
       if (this == 0)
          break;
-      this->seed = ((this->a * this->seed + this->c) % this->modulus);
+      if (this->modulus == 0)
+         break;
+      // 64-bit intermediate result does not overflow
+      this->seed = (int) (((long long) this->a * this->seed + this->c)
+                          % this->modulus);
       write_f (context, linked_channels (context, id),
                this->scale * this->seed);
       break;
@@ -395,45 +1558,1167 @@ void lcg_random_class_func (struct lcg_data *this,
    }
 }
 
+//////////////////////////////////////////////////////////////////////////////
+// Random channel - xoshiro256**, PCG32 and Philox4x32 generators
+//////////////////////////////////////////////////////////////////////////////
+#define RANDOM_XOSHIRO 0
+#define RANDOM_PCG32 1
+#define RANDOM_PHILOX 2
+
+#define RANDOM_UNIFORM 0
+#define RANDOM_NORMAL 1
+#define RANDOM_INT 2
+
+// Samples per write to linked channels
+#define RANDOM_BULK 256
+#define RANDOM_MAX_STREAM 65535
+
+struct prng_data
+{
+   char generator;              // RANDOM_XOSHIRO/PCG32/PHILOX
+   char distribution;           // RANDOM_UNIFORM/NORMAL/INT
+   float a;                     // min or mean
+   float b;                     // max or standard deviation
+   int min;                     // integer range
+   unsigned int range;          // max - min + 1, 0 for full 32 bits
+   union
+   {
+      unsigned long long xoshiro[4];
+      struct
+      {
+         unsigned long long state;
+         unsigned long long increment;
+      } pcg;
+      struct
+      {
+         unsigned int counter[4];
+         unsigned int key[2];
+         unsigned int output[4];
+         int index;             // next unused output word
+      } philox;
+   } state;
+   float latest;
+   int latest_int;
+};
+
+static unsigned long long random_splitmix (unsigned long long *x)
+{
+   unsigned long long z = (*x += 0x9E3779B97F4A7C15ULL);
+   z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+   z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+   return z ^ (z >> 31);
+}
+
+static unsigned long long random_rotl (unsigned long long x, int k)
+{
+   return (x << k) | (x >> (64 - k));
+}
+
+static unsigned long long xoshiro_next (unsigned long long *s)
+{
+   unsigned long long result = random_rotl (s[1] * 5, 7) * 9;
+   unsigned long long t = s[1] << 17;
+   s[2] ^= s[0];
+   s[3] ^= s[1];
+   s[1] ^= s[2];
+   s[0] ^= s[3];
+   s[2] ^= t;
+   s[3] = random_rotl (s[3], 45);
+   return result;
+}
+
+// Advance 2^128 steps. Each jump starts a non-overlapping stream.
+static void xoshiro_jump (unsigned long long *s)
+{
+   static const unsigned long long jump[] = {
+      0x180EC6D33CFBABA6ULL, 0xD5A61266F0C9392CULL,
+      0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL
+   };
+   unsigned long long t[4] = { 0, 0, 0, 0 };
+   int i, b;
+   for (i = 0; i < 4; i++)
+   {
+      for (b = 0; b < 64; b++)
+      {
+         if (jump[i] & (1ULL << b))
+         {
+            t[0] ^= s[0];
+            t[1] ^= s[1];
+            t[2] ^= s[2];
+            t[3] ^= s[3];
+         }
+         xoshiro_next (s);
+      }
+   }
+   s[0] = t[0];
+   s[1] = t[1];
+   s[2] = t[2];
+   s[3] = t[3];
+}
+
+static unsigned int pcg32_next (struct prng_data *this)
+{
+   unsigned long long old = this->state.pcg.state;
+   unsigned int xorshifted = (unsigned int) (((old >> 18) ^ old) >> 27);
+   unsigned int rot = (unsigned int) (old >> 59);
+   this->state.pcg.state = old * 6364136223846793005ULL
+      + this->state.pcg.increment;
+   return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+}
+
+// Philox4x32-10 block of the current counter
+static void philox_block (struct prng_data *this)
+{
+   unsigned int c0 = this->state.philox.counter[0];
+   unsigned int c1 = this->state.philox.counter[1];
+   unsigned int c2 = this->state.philox.counter[2];
+   unsigned int c3 = this->state.philox.counter[3];
+   unsigned int k0 = this->state.philox.key[0];
+   unsigned int k1 = this->state.philox.key[1];
+   int round;
+   for (round = 0; round < 10; round++)
+   {
+      unsigned long long p0 = (unsigned long long) 0xD2511F53 * c0;
+      unsigned long long p1 = (unsigned long long) 0xCD9E8D57 * c2;
+      c0 = (unsigned int) (p1 >> 32) ^ c1 ^ k0;
+      c2 = (unsigned int) (p0 >> 32) ^ c3 ^ k1;
+      c1 = (unsigned int) p1;
+      c3 = (unsigned int) p0;
+      k0 += 0x9E3779B9;
+      k1 += 0xBB67AE85;
+   }
+   this->state.philox.output[0] = c0;
+   this->state.philox.output[1] = c1;
+   this->state.philox.output[2] = c2;
+   this->state.philox.output[3] = c3;
+   this->state.philox.index = 0;
+   // 64-bit block counter. Upper words hold the stream number.
+   if (++this->state.philox.counter[0] == 0)
+      this->state.philox.counter[1]++;
+}
+
+static unsigned int random_next32 (struct prng_data *this)
+{
+   switch (this->generator)
+   {
+   case RANDOM_PCG32:
+      return pcg32_next (this);
+   case RANDOM_PHILOX:
+      if (this->state.philox.index == 4)
+         philox_block (this);
+      return this->state.philox.output[this->state.philox.index++];
+   default:
+      return (unsigned int) (xoshiro_next (this->state.xoshiro) >> 32);
+   }
+}
+
+static void random_seed (struct prng_data *this, int generator,
+                         unsigned int seed, unsigned int stream)
+{
+   unsigned long long x = seed;
+   this->generator = generator;
+   switch (generator)
+   {
+   case RANDOM_PCG32:
+      this->state.pcg.state = 0;
+      this->state.pcg.increment = ((unsigned long long) stream << 1) | 1;
+      pcg32_next (this);
+      this->state.pcg.state += seed;
+      pcg32_next (this);
+      break;
+   case RANDOM_PHILOX:
+      this->state.philox.key[0] = seed;
+      this->state.philox.key[1] = 0;
+      this->state.philox.counter[0] = 0;
+      this->state.philox.counter[1] = 0;
+      this->state.philox.counter[2] = stream;
+      this->state.philox.counter[3] = 0;
+      this->state.philox.index = 4;
+      break;
+   default:
+      this->state.xoshiro[0] = random_splitmix (&x);
+      this->state.xoshiro[1] = random_splitmix (&x);
+      this->state.xoshiro[2] = random_splitmix (&x);
+      this->state.xoshiro[3] = random_splitmix (&x);
+      while (stream-- > 0)
+         xoshiro_jump (this->state.xoshiro);
+      break;
+   }
+}
+
+// Uniform in (0,1). Never 0 so that logarithm is defined.
+static double random_open (struct prng_data *this)
+{
+   return (random_next32 (this) + 0.5) * (1.0 / 4294967296.0);
+}
+
+// Natural logarithm of x > 0
+static double random_log (double x)
+{
+   union
+   {
+      double d;
+      unsigned long long u;
+   } v;
+   double s, s2, sum;
+   int e, i;
+   v.d = x;
+   e = (int) ((v.u >> 52) & 0x7FF) - 1023;
+   v.u = (v.u & 0x000FFFFFFFFFFFFFULL) | 0x3FF0000000000000ULL;
+   if (v.d > 1.41421356237309505)
+   {
+      v.d *= 0.5;
+      e++;
+   }
+   // log(m) = 2 atanh((m - 1) / (m + 1))
+   s = (v.d - 1) / (v.d + 1);
+   s2 = s * s;
+   sum = 0;
+   for (i = 19; i > 1; i -= 2)
+      sum = (sum + 1.0 / i) * s2;
+   return e * 0.693147180559945309 + 2 * s * (1 + sum);
+}
+
+// Exponential function of x <= 0
+static double random_exp (double x)
+{
+   union
+   {
+      double d;
+      unsigned long long u;
+   } scale;
+   double r, sum = 1;
+   int k, i;
+   if (x < -708)
+      return 0;
+   k = (int) (x * 1.44269504088896341 - 0.5);
+   r = x - k * 0.693147180559945309;
+   for (i = 13; i > 0; i--)
+      sum = 1 + sum * r / i;
+   scale.u = (unsigned long long) (k + 1023) << 52;
+   return sum * scale.d;
+}
+
+// Ziggurat tables of 128 layers (Marsaglia & Tsang 2000)
+static const unsigned int ziggurat_k[128] = {
+   0x76ad2212, 0x00000000, 0x600f1b53, 0x6ce447a6, 0x725b46a2, 0x7560051d,
+   0x774921eb, 0x789a25bd, 0x799045c3, 0x7a4bce5d, 0x7adf629f, 0x7b5682a6,
+   0x7bb8a8c6, 0x7c0ae722, 0x7c50cce7, 0x7c8cec5b, 0x7cc12cd6, 0x7ceefed2,
+   0x7d177e0b, 0x7d3b8883, 0x7d5bce6c, 0x7d78dd64, 0x7d932886, 0x7dab0e57,
+   0x7dc0dd30, 0x7dd4d688, 0x7de73185, 0x7df81cea, 0x7e07c0a3, 0x7e163efa,
+   0x7e23b587, 0x7e303dfd, 0x7e3beec2, 0x7e46db77, 0x7e51155d, 0x7e5aabb3,
+   0x7e63abf7, 0x7e6c222c, 0x7e741906, 0x7e7b9a18, 0x7e82adfa, 0x7e895c63,
+   0x7e8fac4b, 0x7e95a3fb, 0x7e9b4924, 0x7ea0a0ef, 0x7ea5b00d, 0x7eaa7ac3,
+   0x7eaf04f3, 0x7eb3522a, 0x7eb765a5, 0x7ebb4259, 0x7ebeeafd, 0x7ec2620a,
+   0x7ec5a9c4, 0x7ec8c441, 0x7ecbb365, 0x7ece78ed, 0x7ed11671, 0x7ed38d62,
+   0x7ed5df12, 0x7ed80cb4, 0x7eda175c, 0x7edc0005, 0x7eddc78e, 0x7edf6ebf,
+   0x7ee0f647, 0x7ee25ebe, 0x7ee3a8a9, 0x7ee4d473, 0x7ee5e276, 0x7ee6d2f5,
+   0x7ee7a620, 0x7ee85c10, 0x7ee8f4cd, 0x7ee97047, 0x7ee9ce59, 0x7eea0eca,
+   0x7eea3147, 0x7eea3568, 0x7eea1aab, 0x7ee9e071, 0x7ee98602, 0x7ee90a88,
+   0x7ee86d08, 0x7ee7ac6a, 0x7ee6c769, 0x7ee5bc9c, 0x7ee48a67, 0x7ee32efc,
+   0x7ee1a857, 0x7edff42f, 0x7ede0ffa, 0x7edbf8d9, 0x7ed9ab94, 0x7ed7248d,
+   0x7ed45fae, 0x7ed1585c, 0x7ece095f, 0x7eca6ccb, 0x7ec67be2, 0x7ec22eee,
+   0x7ebd7d1a, 0x7eb85c35, 0x7eb2c075, 0x7eac9c20, 0x7ea5df27, 0x7e9e769f,
+   0x7e964c16, 0x7e8d44ba, 0x7e834033, 0x7e781728, 0x7e6b9933, 0x7e5d8a1a,
+   0x7e4d9ded, 0x7e3b737a, 0x7e268c2f, 0x7e0e3ff5, 0x7df1aa5d, 0x7dcf8c72,
+   0x7da61a1e, 0x7d72a0fb, 0x7d30e097, 0x7cd9b4ab, 0x7c600f1a, 0x7ba90bdc,
+   0x7a722176, 0x77d664e5
+};
+
+static const float ziggurat_w[128] = {
+   1.729040522e-09f, 1.268092845e-10f, 1.689751777e-10f, 1.986268844e-10f,
+   2.223243179e-10f, 2.424493613e-10f, 2.601613190e-10f, 2.761198871e-10f,
+   2.907396282e-10f, 3.042997041e-10f, 3.169979521e-10f, 3.289802053e-10f,
+   3.403573812e-10f, 3.512160221e-10f, 3.616250995e-10f, 3.716405763e-10f,
+   3.813085643e-10f, 3.906675681e-10f, 3.997501187e-10f, 4.085839862e-10f,
+   4.171930964e-10f, 4.255982353e-10f, 4.338175974e-10f, 4.418672181e-10f,
+   4.497613196e-10f, 4.575125889e-10f, 4.651324048e-10f, 4.726310238e-10f,
+   4.800177347e-10f, 4.873009868e-10f, 4.944884981e-10f, 5.015873466e-10f,
+   5.086040482e-10f, 5.155446229e-10f, 5.224146520e-10f, 5.292193275e-10f,
+   5.359634953e-10f, 5.426516925e-10f, 5.492881800e-10f, 5.558769721e-10f,
+   5.624218613e-10f, 5.689264417e-10f, 5.753941290e-10f, 5.818281786e-10f,
+   5.882317021e-10f, 5.946076818e-10f, 6.009589843e-10f, 6.072883728e-10f,
+   6.135985177e-10f, 6.198920075e-10f, 6.261713578e-10f, 6.324390202e-10f,
+   6.386973906e-10f, 6.449488167e-10f, 6.511956053e-10f, 6.574400293e-10f,
+   6.636843339e-10f, 6.699307434e-10f, 6.761814667e-10f, 6.824387039e-10f,
+   6.887046513e-10f, 6.949815079e-10f, 7.012714804e-10f, 7.075767893e-10f,
+   7.138996747e-10f, 7.202424015e-10f, 7.266072661e-10f, 7.329966016e-10f,
+   7.394127850e-10f, 7.458582428e-10f, 7.523354585e-10f, 7.588469793e-10f,
+   7.653954238e-10f, 7.719834898e-10f, 7.786139632e-10f, 7.852897266e-10f,
+   7.920137693e-10f, 7.987891979e-10f, 8.056192475e-10f, 8.125072942e-10f,
+   8.194568683e-10f, 8.264716694e-10f, 8.335555823e-10f, 8.407126946e-10f,
+   8.479473165e-10f, 8.552640026e-10f, 8.626675754e-10f, 8.701631525e-10f,
+   8.777561764e-10f, 8.854524480e-10f, 8.932581641e-10f, 9.011799601e-10f,
+   9.092249580e-10f, 9.174008206e-10f, 9.257158144e-10f, 9.341788804e-10f,
+   9.427997160e-10f, 9.515888694e-10f, 9.605578494e-10f, 9.697192525e-10f,
+   9.790869128e-10f, 9.886760771e-10f, 9.985036135e-10f, 1.008588259e-09f,
+   1.018950917e-09f, 1.029615015e-09f, 1.040606944e-09f, 1.051956589e-09f,
+   1.063697999e-09f, 1.075870210e-09f, 1.088518296e-09f, 1.101694708e-09f,
+   1.115461010e-09f, 1.129890161e-09f, 1.145069570e-09f, 1.161105243e-09f,
+   1.178127561e-09f, 1.196299505e-09f, 1.215828698e-09f, 1.236985629e-09f,
+   1.260132330e-09f, 1.285769684e-09f, 1.314620185e-09f, 1.347783956e-09f,
+   1.387063532e-09f, 1.435740319e-09f, 1.500865903e-09f, 1.603094794e-09f
+};
+
+static const float ziggurat_f[128] = {
+   1.000000000e+00f, 9.635996931e-01f, 9.362826817e-01f, 9.130436480e-01f,
+   8.922816508e-01f, 8.732430489e-01f, 8.555006079e-01f, 8.387836053e-01f,
+   8.229072114e-01f, 8.077382947e-01f, 7.931770118e-01f, 7.791460859e-01f,
+   7.655841739e-01f, 7.524415592e-01f, 7.396772437e-01f, 7.272569183e-01f,
+   7.151515074e-01f, 7.033360990e-01f, 6.917891434e-01f, 6.804918410e-01f,
+   6.694276673e-01f, 6.585820001e-01f, 6.479418211e-01f, 6.374954773e-01f,
+   6.272324852e-01f, 6.171433708e-01f, 6.072195366e-01f, 5.974531509e-01f,
+   5.878370544e-01f, 5.783646811e-01f, 5.690299911e-01f, 5.598274127e-01f,
+   5.507517931e-01f, 5.417983550e-01f, 5.329626594e-01f, 5.242405727e-01f,
+   5.156282382e-01f, 5.071220511e-01f, 4.987186355e-01f, 4.904148253e-01f,
+   4.822076463e-01f, 4.740943007e-01f, 4.660721527e-01f, 4.581387163e-01f,
+   4.502916437e-01f, 4.425287153e-01f, 4.348478302e-01f, 4.272469983e-01f,
+   4.197243320e-01f, 4.122780401e-01f, 4.049064208e-01f, 3.976078565e-01f,
+   3.903808082e-01f, 3.832238111e-01f, 3.761354695e-01f, 3.691144537e-01f,
+   3.621594954e-01f, 3.552693848e-01f, 3.484429675e-01f, 3.416791412e-01f,
+   3.349768533e-01f, 3.283350984e-01f, 3.217529159e-01f, 3.152293881e-01f,
+   3.087636380e-01f, 3.023548278e-01f, 2.960021568e-01f, 2.897048604e-01f,
+   2.834622082e-01f, 2.772735029e-01f, 2.711380791e-01f, 2.650553023e-01f,
+   2.590245674e-01f, 2.530452985e-01f, 2.471169475e-01f, 2.412389935e-01f,
+   2.354109423e-01f, 2.296323252e-01f, 2.239026994e-01f, 2.182216466e-01f,
+   2.125887731e-01f, 2.070037094e-01f, 2.014661101e-01f, 1.959756531e-01f,
+   1.905320403e-01f, 1.851349970e-01f, 1.797842721e-01f, 1.744796383e-01f,
+   1.692208922e-01f, 1.640078547e-01f, 1.588403711e-01f, 1.537183122e-01f,
+   1.486415742e-01f, 1.436100801e-01f, 1.386237800e-01f, 1.336826526e-01f,
+   1.287867062e-01f, 1.239359802e-01f, 1.191305467e-01f, 1.143705124e-01f,
+   1.096560210e-01f, 1.049872554e-01f, 1.003644410e-01f, 9.578784912e-02f,
+   9.125780083e-02f, 8.677467189e-02f, 8.233889824e-02f, 7.795098251e-02f,
+   7.361150188e-02f, 6.932111739e-02f, 6.508058521e-02f, 6.089077035e-02f,
+   5.675266348e-02f, 5.266740190e-02f, 4.863629586e-02f, 4.466086220e-02f,
+   4.074286807e-02f, 3.688438879e-02f, 3.308788615e-02f, 2.935631744e-02f,
+   2.569329194e-02f, 2.210330462e-02f, 1.859210274e-02f, 1.516729801e-02f,
+   1.183947866e-02f, 8.624484413e-03f, 5.548995221e-03f, 2.669629084e-03f
+};
+
+#define ZIGGURAT_R 3.442619855899
+
+// Standard normal distribution with Ziggurat method
+static float random_normal (struct prng_data *this)
+{
+   for (;;)
+   {
+      int hz = (int) random_next32 (this);
+      int iz = hz & 127;
+      unsigned int magnitude = hz < 0 ? 0u - (unsigned int) hz
+                                      : (unsigned int) hz;
+      double x;
+      if (magnitude < ziggurat_k[iz])
+         return hz * ziggurat_w[iz];       // Inside the layer rectangle
+
+      x = hz * (double) ziggurat_w[iz];
+      if (iz == 0)
+      {
+         // Tail beyond R
+         double y;
+         do
+         {
+            x = -random_log (random_open (this)) / ZIGGURAT_R;
+            y = -random_log (random_open (this));
+         }
+         while (y + y < x * x);
+         return (float) (hz > 0 ? ZIGGURAT_R + x : -ZIGGURAT_R - x);
+      }
+      // Wedge between layers
+      if (ziggurat_f[iz] + random_open (this)
+          * (ziggurat_f[iz - 1] - ziggurat_f[iz]) < random_exp (-0.5 * x * x))
+         return (float) x;
+   }
+}
+
+// Integer in range without modulo bias (Lemire 2019)
+static int random_int (struct prng_data *this)
+{
+   unsigned long long m;
+   if (this->range == 0)
+      return (int) random_next32 (this);
+   m = (unsigned long long) random_next32 (this) * this->range;
+   if ((unsigned int) m < this->range)
+   {
+      unsigned int threshold = (0u - this->range) % this->range;
+      while ((unsigned int) m < threshold)
+         m = (unsigned long long) random_next32 (this) * this->range;
+   }
+   return (int) ((unsigned int) this->min + (unsigned int) (m >> 32));
+}
+
+static float random_float (struct prng_data *this)
+{
+   if (this->distribution == RANDOM_NORMAL)
+      return this->a + this->b * random_normal (this);
+   return this->a + (this->b - this->a)
+      * ((random_next32 (this) >> 8) * (1.0f / 16777216.0f));
+}
+
+void random_class_func (struct prng_data *this,
+                        const struct context_rmcios *context, int id,
+                        enum function_rmcios function,
+                        enum type_rmcios paramtype,
+                        struct combo_rmcios *returnv,
+                        int num_params, const union param_rmcios param)
+{
+   switch (function)
+   {
+   case help_rmcios:
+      return_string (context, returnv,
+                     "random channel - Pseudo random number generator\r\n"
+                     "create random newname\r\n"
+                     "setup newname generator seed(0) | stream(0)\r\n"
+                     "  -generator: xoshiro (xoshiro256**), pcg32"
+                     " or philox (Philox4x32-10)\r\n"
+                     "  -Generators with same seed and different stream"
+                     " produce non-overlapping sequences\r\n"
+                     "  -stream: 0-65535. Setup with other stream"
+                     " is ignored.\r\n"
+                     "setup newname uniform min(0) | max(1)\r\n"
+                     "setup newname normal mean(0) | stddev(1)\r\n"
+                     "setup newname int min(0) | max(99)\r\n"
+                     "  -Integers from min to max\r\n"
+                     "write newname samples(1)\r\n"
+                     "  -Write samples to linked channels."
+                     " Up to 256 samples in single write.\r\n"
+                     "read newname # Latest sample\r\n"
+                     "link newname linked_channel\r\n");
+      break;
+
+   case create_rmcios:
+      if (num_params < 1)
+         break;
+      this = (struct prng_data *)
+             allocate_storage (context, sizeof (struct prng_data), 0);
+      if (this == 0)
+         break;
+      random_seed (this, RANDOM_XOSHIRO, 0, 0);
+      this->distribution = RANDOM_UNIFORM;
+      this->a = 0;
+      this->b = 1;
+      this->min = 0;
+      this->range = 100;
+      this->latest = 0;
+      this->latest_int = 0;
+      create_channel_param (context, paramtype, param, 0,
+                            (class_rmcios) random_class_func, this);
+      break;
+
+   case setup_rmcios:
+      if (this == 0)
+         break;
+      if (num_params < 1)
+         break;
+      {
+         int slen = param_string_alloc_size (context, paramtype, param, 0);
+         char buffer[slen];
+         const char *mode;
+         mode = param_to_string (context, paramtype, param, 0, slen, buffer);
+
+         if (util_keyword (mode, "uniform")
+             || util_keyword (mode, "normal"))
+         {
+            this->distribution = util_keyword (mode, "normal")
+                                 ? RANDOM_NORMAL : RANDOM_UNIFORM;
+            this->a = 0;
+            this->b = 1;
+            if (num_params >= 2)
+               this->a = param_to_float (context, paramtype, param, 1);
+            if (num_params >= 3)
+               this->b = param_to_float (context, paramtype, param, 2);
+         }
+         else if (util_keyword (mode, "int"))
+         {
+            int max = 99;
+            this->distribution = RANDOM_INT;
+            this->min = 0;
+            if (num_params >= 2)
+               this->min = param_to_int (context, paramtype, param, 1);
+            if (num_params >= 3)
+               max = param_to_int (context, paramtype, param, 2);
+            if (max < this->min)
+               max = this->min;
+            this->range = (unsigned int) max - (unsigned int) this->min + 1;
+         }
+         else
+         {
+            int generator = RANDOM_XOSHIRO;
+            unsigned int seed = 0;
+            int stream = 0;
+            if (util_keyword (mode, "pcg32"))
+               generator = RANDOM_PCG32;
+            else if (util_keyword (mode, "philox"))
+               generator = RANDOM_PHILOX;
+            else if (!util_keyword (mode, "xoshiro"))
+               break;
+            if (num_params >= 2)
+               seed = param_to_int (context, paramtype, param, 1);
+            if (num_params >= 3)
+               stream = param_to_int (context, paramtype, param, 2);
+            // xoshiro jumps once per stream number
+            if (stream < 0 || stream > RANDOM_MAX_STREAM)
+               break;
+            random_seed (this, generator, seed, stream);
+         }
+      }
+      break;
+
+   case write_rmcios:
+      if (this == 0)
+         break;
+      {
+         int samples = 1;
+         if (num_params > 0)
+            samples = param_to_int (context, paramtype, param, 0);
+         while (samples > 0)
+         {
+            int n = samples < RANDOM_BULK ? samples : RANDOM_BULK;
+            int i;
+            if (this->distribution == RANDOM_INT)
+            {
+               int values[RANDOM_BULK];
+               for (i = 0; i < n; i++)
+                  values[i] = random_int (this);
+               this->latest_int = values[n - 1];
+               write_iv (context, linked_channels (context, id), n, values);
+            }
+            else
+            {
+               float values[RANDOM_BULK];
+               for (i = 0; i < n; i++)
+                  values[i] = random_float (this);
+               this->latest = values[n - 1];
+               write_fv (context, linked_channels (context, id), n, values);
+            }
+            samples -= n;
+         }
+      }
+      break;
+
+   case read_rmcios:
+      if (this == 0)
+         break;
+      if (this->distribution == RANDOM_INT)
+         return_int (context, returnv, this->latest_int);
+      else
+         return_float (context, returnv, this->latest);
+      break;
+   }
+}
+
+//////////////////////////////////////////////////////
+// Filter channel
+//////////////////////////////////////////////////////
+struct filter_data;
+
+// Returns nonzero when value is filtered out
+typedef int (*filter_test) (struct filter_data *this, float value);
+
+struct filter_data
+{
+   filter_test test;            // compiled at setup
+   float value;                 // compared value or range low limit
+   float high;                  // range high limit
+   int mask;
+   char passing;                // hysteresis state
+};
+
+static int filter_equal (struct filter_data *this, float value)
+{
+   return value == this->value;
+}
+
+static int filter_not_equal (struct filter_data *this, float value)
+{
+   return value != this->value;
+}
+
+static int filter_less (struct filter_data *this, float value)
+{
+   return value < this->value;
+}
+
+static int filter_less_equal (struct filter_data *this, float value)
+{
+   return value <= this->value;
+}
+
+static int filter_greater (struct filter_data *this, float value)
+{
+   return value > this->value;
+}
+
+static int filter_greater_equal (struct filter_data *this, float value)
+{
+   return value >= this->value;
+}
+
+static int filter_inside_closed (struct filter_data *this, float value)
+{
+   return value >= this->value && value <= this->high;
+}
+
+static int filter_inside_open (struct filter_data *this, float value)
+{
+   return value > this->value && value < this->high;
+}
+
+static int filter_inside_closed_open (struct filter_data *this, float value)
+{
+   return value >= this->value && value < this->high;
+}
+
+static int filter_inside_open_closed (struct filter_data *this, float value)
+{
+   return value > this->value && value <= this->high;
+}
+
+static int filter_outside_closed (struct filter_data *this, float value)
+{
+   return !(value >= this->value && value <= this->high);
+}
+
+static int filter_outside_open (struct filter_data *this, float value)
+{
+   return !(value > this->value && value < this->high);
+}
+
+static int filter_outside_closed_open (struct filter_data *this, float value)
+{
+   return !(value >= this->value && value < this->high);
+}
+
+static int filter_outside_open_closed (struct filter_data *this, float value)
+{
+   return !(value > this->value && value <= this->high);
+}
+
+static int filter_mask_any (struct filter_data *this, float value)
+{
+   return ((int) value & this->mask) != 0;
+}
+
+static int filter_mask_none (struct filter_data *this, float value)
+{
+   return ((int) value & this->mask) == 0;
+}
+
+static int filter_all (struct filter_data *this, float value)
+{
+   return 1;
+}
+
+// Gate tests filter all values depending on the setup value
+static int filter_gate_equal_0 (struct filter_data *this, float value)
+{
+   return this->value == 0;
+}
+
+static int filter_gate_equal_1 (struct filter_data *this, float value)
+{
+   return this->value == 1;
+}
+
+static int filter_gate_pass_0 (struct filter_data *this, float value)
+{
+   return this->value != 0;
+}
+
+static int filter_gate_pass_1 (struct filter_data *this, float value)
+{
+   return this->value != 1;
+}
+
+// Schmitt trigger. Pass after rising above high limit,
+// filter after falling below low limit.
+static int filter_hysteresis (struct filter_data *this, float value)
+{
+   if (value > this->high)
+      this->passing = 1;
+   else if (value < this->value)
+      this->passing = 0;
+   return !this->passing;
+}
+
+// Pass after falling below low limit, filter after rising above high.
+static int filter_hysteresis_inverted (struct filter_data *this,
+                                       float value)
+{
+   if (value < this->value)
+      this->passing = 1;
+   else if (value > this->high)
+      this->passing = 0;
+   return !this->passing;
+}
+
+static const struct
+{
+   const char *name;
+   filter_test test;
+} filter_tests[] = {
+   {"=", filter_equal},
+   {"==", filter_equal},
+   {"!=", filter_not_equal},
+   {"<", filter_less},
+   {"<=", filter_less_equal},
+   {"=<", filter_less_equal},
+   {">", filter_greater},
+   {">=", filter_greater_equal},
+   {"=>", filter_greater_equal},
+   {"[]", filter_inside_closed},
+   {"()", filter_inside_open},
+   {"[)", filter_inside_closed_open},
+   {"(]", filter_inside_open_closed},
+   {"![]", filter_outside_closed},
+   {"!()", filter_outside_open},
+   {"![)", filter_outside_closed_open},
+   {"!(]", filter_outside_open_closed},
+   {"hyst", filter_hysteresis},
+   {"!hyst", filter_hysteresis_inverted},
+   {"&", filter_mask_any},
+   {"!&", filter_mask_none},
+   {"=0", filter_gate_equal_0},
+   {"=1", filter_gate_equal_1},
+   {"0", filter_gate_pass_0},
+   {"1", filter_gate_pass_1}
+};
+
+// Compile test string to test function
+static filter_test filter_compile (const char *test)
+{
+   unsigned int i;
+   for (i = 0; i < sizeof (filter_tests) / sizeof (filter_tests[0]); i++)
+   {
+      if (util_keyword (test, filter_tests[i].name))
+         return filter_tests[i].test;
+   }
+   // Undefined test filters everything
+   return filter_all;
+}
+
+void filter_class_func (struct filter_data *this,
+                        const struct context_rmcios *context, int id,
+                        enum function_rmcios function,
+                        enum type_rmcios paramtype,
+                        struct combo_rmcios *returnv,
+                        int num_params, const union param_rmcios param)
+{
+   switch (function)
+   {
+   case help_rmcios:
+      return_string (context, returnv,
+                     "filter channel\r\n"
+                     "create filter newname\r\n"
+                     "setup newname value | test | high\r\n"
+                     " test can be one of following:\r\n"
+                     " = # filter value\r\n"
+                     " == # filter value\r\n"
+                     " != # filter all except value\r\n"
+                     " > # filter greater than value\r\n"
+                     " < # filter less than value\r\n"
+                     " <= # filter less or equal of value\r\n"
+                     " =< # filter less or equal of value\r\n"
+                     " >= # filter greater or equal than value\r\n"
+                     " => # filter greater or equal than value\r\n"
+                     " [] # filter range value..high including limits\r\n"
+                     " () # filter range value..high excluding limits\r\n"
+                     " [) (] # filter range including one limit\r\n"
+                     " ![] !() ![) !(] # filter outside of range\r\n"
+                     " hyst # pass after rising above high,"
+                     " filter after falling below value\r\n"
+                     " !hyst # pass after falling below value,"
+                     " filter after rising above high\r\n"
+                     " & # filter integers with any bit of value set\r\n"
+                     " !& # filter integers with no bit of value set\r\n"
+                     " =0 # filter all when value==0\r\n"
+                     " =1 # filter all when value==1\r\n"
+                     " 0 # pass all when value==0\r\n"
+                     " 1 # pass all when value==1\r\n"
+                     "write newname value\r\n"
+                     " -write value to filter and pass nonfiltered"
+                     " to linked channels\r\n"
+                     "link newname channel\r\n");
+      break;
+
+   case create_rmcios:
+      if (num_params < 1)
+         break;
+      // allocate new data
+      this = (struct filter_data *)
+             allocate_storage (context, sizeof (struct filter_data), 0);
+      if (this == 0)
+         break;
+      this->test = filter_all;
+      this->value = 0;
+      this->high = 0;
+      this->mask = 0;
+      this->passing = 0;
+      // create the channel
+      create_channel_param (context, paramtype, param, 0,
+                            (class_rmcios) filter_class_func, this);
+      break;
+
+   case setup_rmcios:
+      if (this == 0)
+         break;
+      if (num_params < 1)
+         break;
+      this->value = param_to_float (context, paramtype, param, 0);
+      this->mask = param_to_int (context, paramtype, param, 0);
+      // Value only setup keeps the range and hysteresis state
+      if (num_params > 2)
+      {
+         this->high = param_to_float (context, paramtype, param, 2);
+         this->passing = 0;
+      }
+      if (num_params > 1)
+      {
+         int tlen = param_string_alloc_size (context, paramtype, param, 1);
+         char tbuffer[tlen];
+         const char *test;
+         test = param_to_string (context, paramtype, param, 1,
+                                 tlen, tbuffer);
+         this->test = filter_compile (test);
+      }
+      break;
+
+   case write_rmcios:
+      if (this == 0)
+         break;
+      if (num_params > 0)
+      {
+         if (this->test (this, param_to_float (context, paramtype,
+                                               param, 0)))
+            return;
+         run_channel (context, linked_channels (context, id),
+                               function, paramtype, returnv, num_params, param);
+      }
+      break;
+   }
+}
+
+//////////////////////////////////////////////////////
+// Deadband channel - Report by exception
+//////////////////////////////////////////////////////
+struct deadband_value
+{
+   float value;                 // last forwarded value
+   char valid;
+   long long time;              // time of last forward
+};
+
+struct deadband_data
+{
+   float absolute;
+   float relative;
+   long long max_silence;       // ns, 0 for no refresh
+   int num_keys;
+   struct deadband_value single;
+   struct deadband_value *keys;
+};
+
+// Monotonic time for channels that measure intervals
+static long long channel_clock_ns (void)
+{
+#ifdef UTIL_CLOCK
+   return clock_monotonic_ns ();
+#else
+   return 0;
+#endif
+}
+
+// Returns nonzero when value should be forwarded
+static int deadband_check (struct deadband_data *this,
+                           struct deadband_value *last, float value)
+{
+   long long now = channel_clock_ns ();
+   if (last->valid)
+   {
+      int changed;
+      int value_nan = value != value;
+      int last_nan = last->value != last->value;
+      if (value_nan || last_nan)
+         // Change into or out of NaN is always forwarded
+         changed = value_nan != last_nan;
+      else
+      {
+         float difference = value - last->value;
+         float band = this->relative * (last->value < 0 ? -last->value
+                                                        : last->value);
+         if (band < this->absolute)
+            band = this->absolute;
+         if (difference < 0)
+            difference = -difference;
+         changed = difference > band;
+      }
+      if (!changed && !(this->max_silence > 0
+                        && now - last->time >= this->max_silence))
+         return 0;
+   }
+   last->value = value;
+   last->valid = 1;
+   last->time = now;
+   return 1;
+}
+
+void deadband_class_func (struct deadband_data *this,
+                          const struct context_rmcios *context, int id,
+                          enum function_rmcios function,
+                          enum type_rmcios paramtype,
+                          struct combo_rmcios *returnv,
+                          int num_params, const union param_rmcios param)
+{
+   switch (function)
+   {
+   case help_rmcios:
+      return_string (context, returnv,
+                     "deadband channel"
+                     " - Forward only significantly changed values\r\n"
+                     "create deadband newname\r\n"
+                     "setup newname absolute(0) | relative(0)"
+                     " | max_silence(0) | keys(0)\r\n"
+                     " -Forward when value differs from last forwarded"
+                     " value more than absolute or\r\n"
+                     "  relative * |last forwarded value|\r\n"
+                     " -max_silence: Forward also when last forward is"
+                     " older than max_silence seconds. 0 disables.\r\n"
+                     " -keys: number of independent values."
+                     " 0 for single value.\r\n"
+                     "write newname value\r\n"
+                     "write newname key value\r\n"
+                     " -Write keyed value. Keys outside 0..keys-1"
+                     " are forwarded unfiltered.\r\n"
+                     "write newname # Forget last values."
+                     " Next values are forwarded.\r\n"
+                     "read newname | key # Last forwarded value\r\n"
+                     "link newname channel\r\n");
+      break;
+
+   case create_rmcios:
+      if (num_params < 1)
+         break;
+      // allocate new data
+      this = (struct deadband_data *)
+             allocate_storage (context, sizeof (struct deadband_data), 0);
+      if (this == 0)
+         break;
+      this->absolute = 0;
+      this->relative = 0;
+      this->max_silence = 0;
+      this->num_keys = 0;
+      this->single.valid = 0;
+      this->single.value = 0;
+      this->keys = 0;
+      // create the channel
+      create_channel_param (context, paramtype, param, 0,
+                            (class_rmcios) deadband_class_func, this);
+      break;
+
+   case setup_rmcios:
+      if (this == 0)
+         break;
+      if (num_params < 1)
+         break;
+      this->absolute = param_to_float (context, paramtype, param, 0);
+      if (num_params > 1)
+         this->relative = param_to_float (context, paramtype, param, 1);
+      if (num_params > 2)
+         this->max_silence = (long long)
+            (param_to_float (context, paramtype, param, 2) * 1e9);
+      if (num_params > 3)
+      {
+         int num_keys = param_to_int (context, paramtype, param, 3);
+         int i;
+         if (this->keys != 0)
+            free_storage (context, this->keys, 0);
+         this->keys = 0;
+         this->num_keys = 0;
+         if (num_keys > 0)
+            this->keys = (struct deadband_value *)
+               allocate_storage (context,
+                                 num_keys * sizeof (struct deadband_value),
+                                 0);
+         if (this->keys != 0)
+            this->num_keys = num_keys;
+         for (i = 0; i < this->num_keys; i++)
+         {
+            this->keys[i].valid = 0;
+            this->keys[i].value = 0;
+         }
+      }
+      this->single.valid = 0;
+      break;
+
+   case write_rmcios:
+      if (this == 0)
+         break;
+      if (num_params < 1)
+      {
+         int i;
+         this->single.valid = 0;
+         for (i = 0; i < this->num_keys; i++)
+            this->keys[i].valid = 0;
+         break;
+      }
+      if (this->num_keys > 0 && num_params > 1)
+      {
+         int key = param_to_int (context, paramtype, param, 0);
+         if (key >= 0 && key < this->num_keys
+             && !deadband_check (this, this->keys + key,
+                                 param_to_float (context, paramtype,
+                                                 param, 1)))
+            break;
+      }
+      else if (!deadband_check (this, &this->single,
+                                param_to_float (context, paramtype,
+                                                param, 0)))
+         break;
+      run_channel (context, linked_channels (context, id),
+                            function, paramtype, returnv, num_params, param);
+      break;
+
+   case read_rmcios:
+      if (this == 0)
+         break;
+      if (num_params > 0 && this->num_keys > 0)
+      {
+         int key = param_to_int (context, paramtype, param, 0);
+         if (key >= 0 && key < this->num_keys)
+            return_float (context, returnv, this->keys[key].value);
+      }
+      else
+         return_float (context, returnv, this->single.value);
+      break;
+   }
+}
+
 //////////////////////////////////////////////////////
-// Filter channel
+// Rate limiter channel
 //////////////////////////////////////////////////////
-struct filter_data
+#define RATELIMIT_BUCKET 0
+#define RATELIMIT_EVERY 1
+#define RATELIMIT_LATEST 2
+
+struct ratelimit_data
 {
-   float value;
-   int test;                    // ascii char1 | cha2
+   char mode;                   // RATELIMIT_BUCKET/EVERY/LATEST
+   long long interval;          // ns between tokens or forwards
+   long long tolerance;         // burst allowance of token bucket
+   long long next;              // earliest time of next forward
+   int every;
+   int count;
+   unsigned int dropped;
+   unsigned int truncated;      // held writes that did not fit
+
+   // Latest write held back in latest mode. Int and float values
+   // are stored as arrays, other data as bytes.
+   char holding;
+   enum type_rmcios held_type;
+   char *held;
+   int held_size;
+   int held_length;             // bytes or number of values
 };
 
-void filter_class_func (struct filter_data *this,
-                        const struct context_rmcios *context, int id,
-                        enum function_rmcios function,
-                        enum type_rmcios paramtype,
-                        struct combo_rmcios *returnv,
-                        int num_params, const union param_rmcios param)
+// Token bucket as generic cell rate algorithm. next is the theoretical
+// arrival time. Burst of writes may arrive tolerance before it.
+static int ratelimit_bucket (struct ratelimit_data *this, long long now)
+{
+   if (now < this->next - this->tolerance)
+      return 0;
+   if (this->next < now)
+      this->next = now;
+   this->next += this->interval;
+   return 1;
+}
+
+// Store value for forwarding on next trigger
+static void ratelimit_hold (const struct context_rmcios *context,
+                            struct ratelimit_data *this,
+                            enum type_rmcios paramtype,
+                            int num_params, const union param_rmcios param)
+{
+   if (this->holding)
+      this->dropped++;
+   this->holding = 1;
+   this->held_type = paramtype;
+   if (paramtype == int_rmcios || paramtype == float_rmcios)
+   {
+      // int and float have the same size
+      int max = this->held_size / sizeof (int);
+      int i;
+      this->held_length = num_params < max ? num_params : max;
+      if (paramtype == int_rmcios)
+         for (i = 0; i < this->held_length; i++)
+            ((int *) this->held)[i] = param.iv[i];
+      else
+         for (i = 0; i < this->held_length; i++)
+            ((float *) this->held)[i] = param.fv[i];
+      if (num_params > max)
+         this->truncated++;
+   }
+   else
+   {
+      struct buffer_rmcios b;
+      this->held_type = buffer_rmcios;
+      b = param_to_binary (context, paramtype, param, 0,
+                           this->held_size, this->held);
+      this->held_length = b.length < this->held_size ? b.length
+                                                     : this->held_size;
+      // Only the first parameter is held
+      if (num_params > 1
+          || param_binary_length (context, paramtype, param, 0)
+             > this->held_size)
+         this->truncated++;
+   }
+}
+
+static void ratelimit_release (const struct context_rmcios *context,
+                               int id, struct ratelimit_data *this)
+{
+   int destination = linked_channels (context, id);
+   this->holding = 0;
+   if (this->held_type == int_rmcios)
+      write_iv (context, destination, this->held_length, (int *) this->held);
+   else if (this->held_type == float_rmcios)
+      write_fv (context, destination, this->held_length,
+                (float *) this->held);
+   else
+      write_buffer (context, destination, this->held, this->held_length, 0);
+}
+
+void ratelimit_class_func (struct ratelimit_data *this,
+                           const struct context_rmcios *context, int id,
+                           enum function_rmcios function,
+                           enum type_rmcios paramtype,
+                           struct combo_rmcios *returnv,
+                           int num_params, const union param_rmcios param)
 {
    switch (function)
    {
    case help_rmcios:
       return_string (context, returnv,
-                     "filter channel\r\n"
-                     "create filter newname\r\n"
-                     "setup newname value | test\r\n"
-                     " test can be one of following:\r\n"
-                     " = # filter value\r\n"
-                     " == # filter value\r\n"
-                     " > # filter greater than value\r\n"
-                     " < # filter less than value\r\n"
-                     " <= # filter less or equal of value\r\n"
-                     " =< # filter less or equal of value\r\n"
-                     " >= # filter greater or equal than value\r\n"
-                     " => # filter greater or equal than value\r\n"
-                     " =0 # filter all when value==0\r\n"
-                     " =1 # filter all when value==1\r\n"
-                     " 0 # pass all when value==0\r\n"
-                     " 1 # pass all when value==1\r\n"
-                     "write newname value\r\n"
-                     " -write value to filter and pass nonfiltered" 
-                     " to linked channels\r\n"
+                     "ratelimit channel"
+                     " - Limit rate of writes to linked channels\r\n"
+                     "create ratelimit newname\r\n"
+                     "setup newname bucket rate | burst(1)\r\n"
+                     " -Token bucket. Forward on average rate writes"
+                     " per second, at most burst at once.\r\n"
+                     "setup newname every n\r\n"
+                     " -Forward first and then every n:th write.\r\n"
+                     "setup newname latest interval | size(64)\r\n"
+                     " -Forward at most one write per interval seconds."
+                     " Latest write in between\r\n"
+                     "  is held and forwarded on write without"
+                     " parameters (link a clock to it).\r\n"
+                     "  size: maximum bytes of held data."
+                     " Int and float values take 4 bytes each.\r\n"
+                     "  Values that do not fit and buffer parameters"
+                     " after the first are not held.\r\n"
+                     "write newname data\r\n"
+                     "write newname # Forward held write\r\n"
+                     "read newname # Number of dropped writes\r\n"
+                     "read newname truncated"
+                     " # Number of held writes that did not fit\r\n"
                      "link newname channel\r\n");
       break;
 
@@ -441,72 +2726,150 @@ void filter_class_func (struct filter_data *this,
       if (num_params < 1)
          break;
       // allocate new data
-      this = (struct filter_data *) 
-             allocate_storage (context, sizeof (struct filter_data), 0); 
+      this = (struct ratelimit_data *)
+             allocate_storage (context, sizeof (struct ratelimit_data), 0);
       if (this == 0)
          break;
-      this->test = 0;
+      this->mode = RATELIMIT_EVERY;
+      this->interval = 0;
+      this->tolerance = 0;
+      this->next = 0;
+      this->every = 1;
+      this->count = 0;
+      this->dropped = 0;
+      this->truncated = 0;
+      this->holding = 0;
+      this->held = 0;
+      this->held_size = 0;
+      this->held_length = 0;
       // create the channel
-      create_channel_param (context, paramtype, param, 0, 
-                            (class_rmcios) filter_class_func, this);
+      create_channel_param (context, paramtype, param, 0,
+                            (class_rmcios) ratelimit_class_func, this);
       break;
 
    case setup_rmcios:
       if (this == 0)
          break;
-      if (num_params < 1)
+      if (num_params < 2)
          break;
-      this->value = param_to_float (context, paramtype, param, 0);
-      if (num_params > 1)
       {
-         char test[2];
-         test[1] = 0;
-         param_to_buffer (context, paramtype, param, 1, 2, test);
-         this->test = test[0] + test[1];
+         int slen = param_string_alloc_size (context, paramtype, param, 0);
+         char buffer[slen];
+         const char *mode;
+         float value = param_to_float (context, paramtype, param, 1);
+         mode = param_to_string (context, paramtype, param, 0, slen, buffer);
+
+         this->next = 0;
+         this->count = 0;
+         this->holding = 0;
+         if (util_keyword (mode, "bucket"))
+         {
+            int burst = 1;
+            if (value <= 0)
+               break;
+            if (num_params > 2)
+               burst = param_to_int (context, paramtype, param, 2);
+            if (burst < 1)
+               burst = 1;
+            this->mode = RATELIMIT_BUCKET;
+            this->interval = (long long) (1e9 / value);
+            this->tolerance = this->interval * (burst - 1);
+         }
+         else if (util_keyword (mode, "every"))
+         {
+            this->mode = RATELIMIT_EVERY;
+            this->every = (int) value < 1 ? 1 : (int) value;
+         }
+         else if (util_keyword (mode, "latest"))
+         {
+            int size = 64;
+            if (num_params > 2)
+               size = param_to_int (context, paramtype, param, 2);
+            if (size < (int) sizeof (int))
+               size = sizeof (int);
+            if (this->held != 0)
+               free_storage (context, this->held, 0);
+            this->held_size = 0;
+            this->held = (char *) allocate_storage (context, size, 0);
+            if (this->held == 0)
+               break;
+            this->held_size = size;
+            this->mode = RATELIMIT_LATEST;
+            this->interval = (long long) (value * 1e9);
+         }
       }
       break;
 
    case write_rmcios:
       if (this == 0)
          break;
-      if (num_params > 0)
+      if (num_params < 1)
       {
-         float value = param_to_float (context, paramtype, param, 0);
-         switch (this->test)
+         // Trigger of held write
+         if (this->holding)
          {
-         case '=':
-            if (this->value == value)
-               return;
-            break;
+            this->next = channel_clock_ns () + this->interval;
+            ratelimit_release (context, id, this);
+         }
+         break;
+      }
+      switch (this->mode)
+      {
+      case RATELIMIT_BUCKET:
+         if (!ratelimit_bucket (this, channel_clock_ns ()))
+         {
+            this->dropped++;
+            return;
+         }
+         break;
 
-         case '<' + '=':
-            if (this->value == value)
-               return;
-         case '<':
-            if (this->value < value)
-               return;
-            break;
+      case RATELIMIT_EVERY:
+         if (this->count-- > 0)
+         {
+            this->dropped++;
+            return;
+         }
+         this->count = this->every - 1;
+         break;
 
-         case '>' + '=':
-            if (this->value == value)
-               return;
-         case '>':
-            if (this->value > value)
+      case RATELIMIT_LATEST:
+         {
+            long long now = channel_clock_ns ();
+            if (now < this->next)
+            {
+               ratelimit_hold (context, this, paramtype, num_params, param);
                return;
+            }
+            if (this->holding)
+            {
+               // Replaced by newer write
+               this->holding = 0;
+               this->dropped++;
+            }
+            this->next = now + this->interval;
+         }
+         break;
+      }
+      run_channel (context, linked_channels (context, id),
+                            function, paramtype, returnv, num_params, param);
+      break;
+
+   case read_rmcios:
+      if (this == 0)
+         break;
+      if (num_params > 0)
+      {
+         int slen = param_string_alloc_size (context, paramtype, param, 0);
+         char buffer[slen];
+         const char *what;
+         what = param_to_string (context, paramtype, param, 0, slen, buffer);
+         if (util_keyword (what, "truncated"))
+         {
+            return_int (context, returnv, this->truncated);
             break;
-         case '0' + '0':
-            if (this->value != 0)
-               return;
-         case '1':
-            if (this->value != 1)
-               return;
-         default:
-            // Undefined filter identifier
-            return;     
          }
-         run_channel (context, linked_channels (context, id),
-                               function, paramtype, returnv, num_params, param);
       }
+      return_int (context, returnv, this->dropped);
       break;
    }
 }
@@ -552,61 +2915,462 @@ static const unsigned char BitReverseTable256[] = {
    0x3F, 0xBF, 0x7F, 0xFF
 };
 
-const unsigned short crc16table_0x8005[256] = {
-   0x0000, 0x8005, 0x800F, 0x000A, 0x801B, 0x001E, 0x0014, 0x8011,
-   0x8033, 0x0036, 0x003C, 0x8039, 0x0028, 0x802D, 0x8027, 0x0022,
-   0x8063, 0x0066, 0x006C, 0x8069, 0x0078, 0x807D, 0x8077, 0x0072,
-   0x0050, 0x8055, 0x805F, 0x005A, 0x804B, 0x004E, 0x0044, 0x8041,
-   0x80C3, 0x00C6, 0x00CC, 0x80C9, 0x00D8, 0x80DD, 0x80D7, 0x00D2,
-   0x00F0, 0x80F5, 0x80FF, 0x00FA, 0x80EB, 0x00EE, 0x00E4, 0x80E1,
-   0x00A0, 0x80A5, 0x80AF, 0x00AA, 0x80BB, 0x00BE, 0x00B4, 0x80B1,
-   0x8093, 0x0096, 0x009C, 0x8099, 0x0088, 0x808D, 0x8087, 0x0082,
-   0x8183, 0x0186, 0x018C, 0x8189, 0x0198, 0x819D, 0x8197, 0x0192,
-   0x01B0, 0x81B5, 0x81BF, 0x01BA, 0x81AB, 0x01AE, 0x01A4, 0x81A1,
-   0x01E0, 0x81E5, 0x81EF, 0x01EA, 0x81FB, 0x01FE, 0x01F4, 0x81F1,
-   0x81D3, 0x01D6, 0x01DC, 0x81D9, 0x01C8, 0x81CD, 0x81C7, 0x01C2,
-   0x0140, 0x8145, 0x814F, 0x014A, 0x815B, 0x015E, 0x0154, 0x8151,
-   0x8173, 0x0176, 0x017C, 0x8179, 0x0168, 0x816D, 0x8167, 0x0162,
-   0x8123, 0x0126, 0x012C, 0x8129, 0x0138, 0x813D, 0x8137, 0x0132,
-   0x0110, 0x8115, 0x811F, 0x011A, 0x810B, 0x010E, 0x0104, 0x8101,
-   0x8303, 0x0306, 0x030C, 0x8309, 0x0318, 0x831D, 0x8317, 0x0312,
-   0x0330, 0x8335, 0x833F, 0x033A, 0x832B, 0x032E, 0x0324, 0x8321,
-   0x0360, 0x8365, 0x836F, 0x036A, 0x837B, 0x037E, 0x0374, 0x8371,
-   0x8353, 0x0356, 0x035C, 0x8359, 0x0348, 0x834D, 0x8347, 0x0342,
-   0x03C0, 0x83C5, 0x83CF, 0x03CA, 0x83DB, 0x03DE, 0x03D4, 0x83D1,
-   0x83F3, 0x03F6, 0x03FC, 0x83F9, 0x03E8, 0x83ED, 0x83E7, 0x03E2,
-   0x83A3, 0x03A6, 0x03AC, 0x83A9, 0x03B8, 0x83BD, 0x83B7, 0x03B2,
-   0x0390, 0x8395, 0x839F, 0x039A, 0x838B, 0x038E, 0x0384, 0x8381,
-   0x0280, 0x8285, 0x828F, 0x028A, 0x829B, 0x029E, 0x0294, 0x8291,
-   0x82B3, 0x02B6, 0x02BC, 0x82B9, 0x02A8, 0x82AD, 0x82A7, 0x02A2,
-   0x82E3, 0x02E6, 0x02EC, 0x82E9, 0x02F8, 0x82FD, 0x82F7, 0x02F2,
-   0x02D0, 0x82D5, 0x82DF, 0x02DA, 0x82CB, 0x02CE, 0x02C4, 0x82C1,
-   0x8243, 0x0246, 0x024C, 0x8249, 0x0258, 0x825D, 0x8257, 0x0252,
-   0x0270, 0x8275, 0x827F, 0x027A, 0x826B, 0x026E, 0x0264, 0x8261,
-   0x0220, 0x8225, 0x822F, 0x022A, 0x823B, 0x023E, 0x0234, 0x8231,
-   0x8213, 0x0216, 0x021C, 0x8219, 0x0208, 0x820D, 0x8207, 0x0202
-};
+////////////////////////////////////////////////////////////////////////
+// CRC engine for widths 1-64 with Rocksoft model parameters
+// (poly, init, refin, refout, xorout).
+// The register is kept left aligned in 64 bits for normal CRCs and right
+// aligned for reflected CRCs, so one slicing-by-8 kernel handles all
+// widths: 8 input bytes are combined with 8 table lookups.
+////////////////////////////////////////////////////////////////////////
+#define CRC_SLICES 8
 
-const unsigned int SHIFTER = 0x00FF;
+// Lookup tables shared by all channels with same width, polynomial
+// and reflection.
+struct crc_table
+{
+   int width;
+   unsigned long long poly;
+   char reflected;
+   char ready;
+   unsigned long long table[CRC_SLICES][256];
+   struct crc_table *next;
+};
 
-struct crc16_data
+struct crc_data
 {
-   unsigned short CRC16;
-   unsigned short poly;
-   const unsigned short *crc16table;
-   unsigned short init;
+   int width;
+   unsigned long long poly;
+   unsigned long long init;
    char refin;
    char refout;
-   unsigned short xor_out;
+   char hardware;               // CRC-32C with SSE4.2 instruction
+   unsigned long long xor_out;
+   unsigned long long crc;      // register in table orientation
+   const struct crc_table *tables;
+};
+
+static unsigned long long crc_mask (int width)
+{
+   return width >= 64 ? ~0ULL : (1ULL << width) - 1;
+}
+
+// Reverse bit order of width bit value
+static unsigned long long crc_reflect (unsigned long long value, int width)
+{
+   unsigned long long r = 0;
+   int i;
+   for (i = 0; i < 64; i += 8)
+      r = r << 8 | BitReverseTable256[(value >> i) & 0xFF];
+   return r >> (64 - width);
+}
+
+// Table k gives the register effect of byte followed by k zero bytes
+static void crc_make_table (unsigned long long table[][256], int width,
+                            unsigned long long poly, int reflected)
+{
+   int i, k;
+   poly &= crc_mask (width);
+   for (i = 0; i < 256; i++)
+   {
+      unsigned long long r;
+      if (reflected)
+      {
+         unsigned long long p = crc_reflect (poly, width);
+         r = i;
+         for (k = 0; k < 8; k++)
+            r = (r & 1) ? (r >> 1) ^ p : r >> 1;
+      }
+      else
+      {
+         unsigned long long p = poly << (64 - width);
+         r = (unsigned long long) i << 56;
+         for (k = 0; k < 8; k++)
+            r = (r >> 63) ? (r << 1) ^ p : r << 1;
+      }
+      table[0][i] = r;
+   }
+   for (k = 1; k < CRC_SLICES; k++)
+      for (i = 0; i < 256; i++)
+      {
+         unsigned long long r = table[k - 1][i];
+         if (reflected)
+            table[k][i] = (r >> 8) ^ table[0][r & 0xFF];
+         else
+            table[k][i] = (r << 8) ^ table[0][r >> 56];
+      }
+}
+
+// Tables of common CRCs are in static storage. Others are allocated
+// on first use and kept for the lifetime of the process.
+static struct crc_table crc_common_tables[] = {
+   {16, 0x8005, 1},             // CRC-16/ARC, CRC-16/MODBUS
+   {16, 0x8005, 0},             // CRC-16/BUYPASS (channel default)
+   {16, 0x1021, 0},             // CRC-16/CCITT-FALSE, CRC-16/XMODEM
+   {16, 0x1021, 1},             // CRC-16/KERMIT, CRC-16/X-25
+   {32, 0x04C11DB7, 1},         // CRC-32
+   {32, 0x1EDC6F41, 1}          // CRC-32C
+};
+static struct crc_table *crc_tables = 0;
+
+static const struct crc_table *crc_get_table (const struct context_rmcios
+                                              *context, int width,
+                                              unsigned long long poly,
+                                              int reflected)
+{
+   struct crc_table *t;
+   int i;
+
+   poly &= crc_mask (width);
+   reflected = (reflected != 0);
+   for (i = 0;
+        i < (int) (sizeof (crc_common_tables) / sizeof (struct crc_table));
+        i++)
+   {
+      t = crc_common_tables + i;
+      if (t->width == width && t->poly == poly && t->reflected == reflected)
+      {
+         if (t->ready == 0)
+         {
+            crc_make_table (t->table, width, poly, reflected);
+            t->ready = 1;
+         }
+         return t;
+      }
+   }
+   for (t = crc_tables; t != 0; t = t->next)
+   {
+      if (t->width == width && t->poly == poly && t->reflected == reflected)
+         return t;
+   }
+
+   t = (struct crc_table *)
+      allocate_storage (context, sizeof (struct crc_table), 0);
+   if (t == 0)
+      return 0;
+   t->width = width;
+   t->poly = poly;
+   t->reflected = reflected;
+   t->ready = 1;
+   crc_make_table (t->table, width, poly, reflected);
+   t->next = crc_tables;
+   crc_tables = t;
+   return t;
+}
+
+#if defined(__GNUC__) && defined(__SSE4_2__) && defined(__x86_64__)
+#define CRC_HARDWARE_CRC32C
+static unsigned long long crc32c_update (unsigned long long crc,
+                                         const unsigned char *data,
+                                         int length)
+{
+   while (length >= 8)
+   {
+      unsigned long long word;
+      __builtin_memcpy (&word, data, 8);
+      crc = __builtin_ia32_crc32di (crc, word);
+      data += 8;
+      length -= 8;
+   }
+   while (length-- > 0)
+      crc = __builtin_ia32_crc32qi ((unsigned int) crc, *data++);
+   return crc;
+}
+#endif
+
+static unsigned long long crc_update (const unsigned long long table[][256],
+                                      int reflected, unsigned long long crc,
+                                      const unsigned char *data, int length)
+{
+   if (reflected)
+   {
+      while (length >= 8)
+      {
+         crc ^= (unsigned long long) data[0]
+            | (unsigned long long) data[1] << 8
+            | (unsigned long long) data[2] << 16
+            | (unsigned long long) data[3] << 24
+            | (unsigned long long) data[4] << 32
+            | (unsigned long long) data[5] << 40
+            | (unsigned long long) data[6] << 48
+            | (unsigned long long) data[7] << 56;
+         crc = table[7][crc & 0xFF] ^ table[6][(crc >> 8) & 0xFF]
+            ^ table[5][(crc >> 16) & 0xFF] ^ table[4][(crc >> 24) & 0xFF]
+            ^ table[3][(crc >> 32) & 0xFF] ^ table[2][(crc >> 40) & 0xFF]
+            ^ table[1][(crc >> 48) & 0xFF] ^ table[0][crc >> 56];
+         data += 8;
+         length -= 8;
+      }
+      while (length-- > 0)
+         crc = (crc >> 8) ^ table[0][(crc ^ *data++) & 0xFF];
+   }
+   else
+   {
+      while (length >= 8)
+      {
+         crc ^= (unsigned long long) data[0] << 56
+            | (unsigned long long) data[1] << 48
+            | (unsigned long long) data[2] << 40
+            | (unsigned long long) data[3] << 32
+            | (unsigned long long) data[4] << 24
+            | (unsigned long long) data[5] << 16
+            | (unsigned long long) data[6] << 8
+            | (unsigned long long) data[7];
+         crc = table[7][crc >> 56] ^ table[6][(crc >> 48) & 0xFF]
+            ^ table[5][(crc >> 40) & 0xFF] ^ table[4][(crc >> 32) & 0xFF]
+            ^ table[3][(crc >> 24) & 0xFF] ^ table[2][(crc >> 16) & 0xFF]
+            ^ table[1][(crc >> 8) & 0xFF] ^ table[0][crc & 0xFF];
+         data += 8;
+         length -= 8;
+      }
+      while (length-- > 0)
+         crc = (crc << 8) ^ table[0][(crc >> 56) ^ *data++];
+   }
+   return crc;
+}
+
+// Convert register value to table orientation
+static unsigned long long crc_register (const struct crc_data *this,
+                                        unsigned long long value)
+{
+   value &= crc_mask (this->width);
+   if (this->refin)
+      return crc_reflect (value, this->width);
+   return value << (64 - this->width);
+}
+
+static unsigned long long crc_value (const struct crc_data *this)
+{
+   unsigned long long crc = this->crc;
+   if (!this->refin)
+      crc >>= 64 - this->width;
+   if (this->refin != this->refout)
+      crc = crc_reflect (crc, this->width);
+   return (crc ^ this->xor_out) & crc_mask (this->width);
+}
+
+static unsigned long long crc_sequential (const struct crc_data *this,
+                                          unsigned long long crc,
+                                          const unsigned char *data,
+                                          int length)
+{
+#ifdef CRC_HARDWARE_CRC32C
+   if (this->hardware)
+      return crc32c_update (crc, data, length);
+#endif
+   return crc_update (this->tables->table, this->refin, crc, data, length);
+}
+
+#ifdef UTIL_THREADS
+// Buffers larger than this are split to chunks calculated in parallel
+#define CRC_PARALLEL_THRESHOLD (1 << 20)
+#define CRC_MIN_CHUNK (256 * 1024)
+#define CRC_MAX_THREADS 16
+
+static unsigned long long gf2_matrix_times (const unsigned long long *matrix,
+                                            unsigned long long vector)
+{
+   unsigned long long sum = 0;
+   while (vector)
+   {
+      if (vector & 1)
+         sum ^= *matrix;
+      vector >>= 1;
+      matrix++;
+   }
+   return sum;
+}
+
+// Register after length zero bytes. Processing zero bytes is linear
+// in GF(2), so it is done as the one byte operator matrix raised to
+// power length by repeated squaring.
+static unsigned long long crc_shift (const struct crc_data *this,
+                                     unsigned long long crc, int length)
+{
+   static const unsigned char zero = 0;
+   unsigned long long op[64];
+   unsigned long long square[64];
+   int i;
+
+   for (i = 0; i < 64; i++)
+      op[i] = crc_update (this->tables->table, this->refin, 1ULL << i,
+                          &zero, 1);
+   while (length > 0)
+   {
+      if (length & 1)
+         crc = gf2_matrix_times (op, crc);
+      length >>= 1;
+      if (length == 0)
+         break;
+      for (i = 0; i < 64; i++)
+         square[i] = gf2_matrix_times (op, op[i]);
+      for (i = 0; i < 64; i++)
+         op[i] = square[i];
+   }
+   return crc;
+}
+
+// Register after crc2 data: crc1 is the register before the data and
+// crc2 is the register of the same data calculated from zero register.
+static unsigned long long crc_combine (const struct crc_data *this,
+                                       unsigned long long crc1,
+                                       unsigned long long crc2, int length2)
+{
+   return crc_shift (this, crc1, length2) ^ crc2;
+}
+
+struct crc_chunk
+{
+   const struct crc_data *crc;
+   const unsigned char *data;
+   int length;
+   unsigned long long result;
 };
 
-// Should be upgraded to handle byte checksums with variying byte orderings.
-void crc16_class_func (struct crc16_data *this,
-                       const struct context_rmcios *context, int id,
-                       enum function_rmcios function,
-                       enum type_rmcios paramtype,
-                       struct combo_rmcios *returnv,
-                       int num_params, const union param_rmcios param)
+THREAD_FUNCTION (crc_chunk_thread, arg)
+{
+   struct crc_chunk *chunk = (struct crc_chunk *) arg;
+   chunk->result = crc_sequential (chunk->crc, 0, chunk->data,
+                                   chunk->length);
+   return 0;
+}
+
+// Calculate chunks in threads and combine the results.
+// First chunk is calculated by calling thread.
+static unsigned long long crc_parallel (const struct crc_data *this,
+                                        unsigned long long crc,
+                                        const unsigned char *data,
+                                        int length)
+{
+   struct crc_chunk chunks[CRC_MAX_THREADS];
+   thread_handle threads[CRC_MAX_THREADS];
+   char started[CRC_MAX_THREADS];
+   int n = processor_count ();
+   int chunk_length, i;
+
+   if (n > length / CRC_MIN_CHUNK)
+      n = length / CRC_MIN_CHUNK;
+   if (n > CRC_MAX_THREADS)
+      n = CRC_MAX_THREADS;
+   if (n < 2)
+      return crc_sequential (this, crc, data, length);
+
+   chunk_length = length / n;
+   for (i = 0; i < n; i++)
+   {
+      chunks[i].crc = this;
+      chunks[i].data = data + i * chunk_length;
+      chunks[i].length = (i == n - 1) ? length - i * chunk_length
+                                      : chunk_length;
+      started[i] = (i > 0)
+         && thread_start (threads + i, crc_chunk_thread, chunks + i);
+   }
+   crc = crc_sequential (this, crc, chunks[0].data, chunks[0].length);
+   for (i = 1; i < n; i++)
+   {
+      if (started[i])
+         thread_join (threads[i]);
+      else
+         crc_chunk_thread (chunks + i);
+      crc = crc_combine (this, crc, chunks[i].result, chunks[i].length);
+   }
+   return crc;
+}
+#endif
+
+static void crc_calculate (struct crc_data *this,
+                           const unsigned char *data, int length)
+{
+#ifdef UTIL_THREADS
+   if (length >= CRC_PARALLEL_THRESHOLD)
+   {
+      this->crc = crc_parallel (this, this->crc, data, length);
+      return;
+   }
+#endif
+   this->crc = crc_sequential (this, this->crc, data, length);
+}
+
+// Parse 64 bit parameter. Accepts decimal, negative and 0x prefixed hex.
+static unsigned long long crc_param (const struct context_rmcios *context,
+                                     enum type_rmcios paramtype,
+                                     const union param_rmcios param,
+                                     int index)
+{
+   char buffer[32];
+   const char *s;
+   unsigned long long value = 0;
+   int negative = 0;
+
+   if (paramtype == int_rmcios)
+      return (long long) param.iv[index];
+   s = param_to_string (context, paramtype, param, index, sizeof (buffer),
+                        buffer);
+   while (*s == ' ')
+      s++;
+   if (*s == '-')
+   {
+      negative = 1;
+      s++;
+   }
+   if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X'))
+   {
+      for (s += 2;; s++)
+      {
+         if (*s >= '0' && *s <= '9')
+            value = value << 4 | (*s - '0');
+         else if (*s >= 'a' && *s <= 'f')
+            value = value << 4 | (*s - 'a' + 10);
+         else if (*s >= 'A' && *s <= 'F')
+            value = value << 4 | (*s - 'A' + 10);
+         else
+            break;
+      }
+   }
+   else
+      for (; *s >= '0' && *s <= '9'; s++)
+         value = value * 10 + (*s - '0');
+   return negative ? 0 - value : value;
+}
+
+static void crc_return (const struct context_rmcios *context,
+                        struct combo_rmcios *returnv, int width,
+                        unsigned long long value)
+{
+   if (width <= 32)
+      return_int (context, returnv, (int) value);
+   else
+   {
+      // Too wide for integer. Return as hex string.
+      char s[19];
+      int i;
+      s[0] = '0';
+      s[1] = 'x';
+      for (i = 0; i < 16; i++)
+         s[2 + i] = "0123456789ABCDEF"[(value >> (60 - 4 * i)) & 0xF];
+      s[18] = 0;
+      return_string (context, returnv, s);
+   }
+}
+
+// Select tables for changed parameters
+static void crc_setup_table (const struct context_rmcios *context,
+                             struct crc_data *this)
+{
+   this->tables = crc_get_table (context, this->width, this->poly,
+                                 this->refin);
+   this->hardware = (this->width == 32 && this->refin
+                     && this->poly == 0x1EDC6F41);
+#ifndef CRC_HARDWARE_CRC32C
+   this->hardware = 0;
+#endif
+}
+
+void crc_class_func (struct crc_data *this,
+                     const struct context_rmcios *context, int id,
+                     enum function_rmcios function,
+                     enum type_rmcios paramtype,
+                     struct combo_rmcios *returnv,
+                     int num_params, const union param_rmcios param)
 {
    switch (function)
    {
@@ -615,20 +3379,26 @@ void crc16_class_func (struct crc16_data *this,
                "CRC channel - "
                "channel for creating and checking CRC checksums.\r\n"
                "create crc newname | bits(16)\r\n"
+               "  -bits: CRC width 1-64. Default polynomials:\r\n"
+               "   8:0x07 16:0x8005 32:0x04C11DB7 64:0x42F0E1EBA9EA3693\r\n"
                "write crc data\r\n"
-               "  -return the crc for data\r\n"
+               "  -return the CRC-16/ARC for data\r\n"
                "setup newname sum(0) | Poly(0x8005) | Init(0) |"
                " RefIn(0) | RefOut(0) | XorOut(0x0000)   \r\n"
                "  -Set the stored sum, and calculation polynomial\r\n"
+               "  -CRC-32: setup name 0xFFFFFFFF 0x04C11DB7 0xFFFFFFFF"
+               " 1 1 0xFFFFFFFF\r\n"
                "setup newname\r\n"
                "  -Reset the sum\r\n"
                "write newname data\r\n"
                "  -Sum the data in buffer to the checksum\r\n"
                "write newname\r\n"
-               "  -Sends checksum to linked channels.\r\n"
+               "  -Sends checksum to linked channels"
+               " (least significant byte first).\r\n"
                "  -Reset the sum\r\n"
                "read newname\r\n"
-               "  -Returns stored checksum\r\n"
+               "  -Returns stored checksum."
+               " Over 32 bit checksum is returned as hex string.\r\n"
                "link newname channel\r\n");
          break;
 
@@ -636,156 +3406,118 @@ void crc16_class_func (struct crc16_data *this,
          if (num_params < 1)
             break;
          // allocate new data
-         this = (struct crc16_data *) 
-            allocate_storage (context, sizeof (struct crc16_data), 0);   
+         this = (struct crc_data *) 
+            allocate_storage (context, sizeof (struct crc_data), 0);   
          if (this == 0)
             break;
-         this->CRC16 = 0;
-         this->poly = 0x8005;
-         this->crc16table = crc16table_0x8005;
+         this->width = 16;
+         if (num_params >= 2)
+            this->width = param_to_integer (context, paramtype, param, 1);
+         if (this->width < 1 || this->width > 64)
+            this->width = 16;
+         switch (this->width)
+         {
+            case 8:
+               this->poly = 0x07;
+               break;
+            case 32:
+               this->poly = 0x04C11DB7;
+               break;
+            case 64:
+               this->poly = 0x42F0E1EBA9EA3693ULL;
+               break;
+            default:
+               this->poly = 0x8005 & crc_mask (this->width);
+               break;
+         }
          this->init = 0;
          this->refin = 0;
          this->refout = 0;
          this->xor_out = 0;
+         this->crc = 0;
+         crc_setup_table (context, this);
          // create the channel
          create_channel_param (context, paramtype, param, 0, 
-               (class_rmcios) crc16_class_func, this); 
+               (class_rmcios) crc_class_func, this); 
          break;
 
       case setup_rmcios:
          if (this == 0)
             break;
-         this->CRC16 = this->init;
-         if (num_params < 1)
-            break;
-         this->CRC16 = param_to_integer (context, paramtype, param, 0);
-         if (num_params < 2)
-            break;
-         this->poly = param_to_integer (context, paramtype, param, 1);
-         switch (this->poly)
+         if (num_params >= 2)
          {
-            case 0x8005:
-               this->crc16table = crc16table_0x8005;
-               break;
-            default: // Allocate and calculate new lookup table
-               {
-                  unsigned short index;
-                  unsigned short r;
-                  unsigned short *t;
-                  t = (unsigned short *) allocate_storage (context,
-                        256 *
-                        sizeof (unsigned
-                           short), 0);
-                  for (index = 0; index < 256; index++)
-                  {
-                     int i;
-                     r = index << 8;
-                     for (i = 0; i < 8; i++)
-                     {
-                        if (r & 0x8000)
-                           r = (r << 1) ^ this->poly;
-                        else
-                           r <<= 1;
-                     }
-                     t[index] = r & 0xFFFF;
-                  }
-                  this->crc16table = t;
-               }
-               break;
+            this->poly = crc_param (context, paramtype, param, 1)
+               & crc_mask (this->width);
+            if (num_params >= 3)
+               this->init = crc_param (context, paramtype, param, 2);
+            if (num_params >= 4)
+               this->refin = param_to_integer (context, paramtype, param, 3);
+            if (num_params >= 5)
+               this->refout = param_to_integer (context, paramtype, param, 4);
+            if (num_params >= 6)
+               this->xor_out = crc_param (context, paramtype, param, 5)
+                  & crc_mask (this->width);
+            crc_setup_table (context, this);
          }
-         if (num_params < 3)
-            break;
-         this->init = param_to_integer (context, paramtype, param, 2);
-         this->CRC16 = this->init;
-         if (num_params < 4)
-            break;
-         this->refin = param_to_integer (context, paramtype, param, 3);
-         if (num_params < 5)
-            break;
-         this->refout = param_to_integer (context, paramtype, param, 4);
-         if (num_params < 6)
-            break;
-         this->xor_out = param_to_integer (context, paramtype, param, 5);
+         if (num_params >= 3 || num_params < 1)
+            this->crc = crc_register (this, this->init);
+         else
+            this->crc = crc_register (this,
+                                      crc_param (context, paramtype, param, 0));
          break;
 
       case read_rmcios:
          if (this == 0)
             break;
-
-         unsigned short CRC16;
-         if (this->refout == 1)
-            CRC16 =
-               this->
-               xor_out ^ (BitReverseTable256[this->CRC16 >> 8] |
-                     BitReverseTable256[this->CRC16 & 0xFF] << 8);
-         else
-            CRC16 = this->xor_out ^ this->CRC16;
-
-         return_int (context, returnv, CRC16);
+         crc_return (context, returnv, this->width, crc_value (this));
          break;
 
       case write_rmcios:
-         if (this == 0)    // Default (modbus CRC)
+         if (this == 0)    // Default CRC-16/ARC
          {
-            unsigned short CRC16 = 0;
+            const struct crc_table *arc;
+            if (num_params < 1)
+               break;
             int blen = param_buffer_alloc_size (context, paramtype, param, 0);
-            {
-               char buffer[blen];
-               struct buffer_rmcios p;
-               int i;
-               p = param_to_buffer (context, paramtype, param, 0, blen, buffer);
-               char *input = p.data;
-               for (i = 0; i < p.length; i++)
-               {
-                  unsigned char byte = *(unsigned char *) input++;
-                  // Reflect input
-                  byte = BitReverseTable256[byte];
-                  unsigned short tableValue =
-                     crc16table_0x8005[((CRC16 >> 8) ^ byte) & SHIFTER];
-                  CRC16 = (CRC16 << 8) ^ tableValue;
-               }
-
-               // Reflect output
-               return_int (context, returnv,
-                     BitReverseTable256[CRC16 >> 8] |
-                     BitReverseTable256[CRC16 & 0xFF] << 8);
-            }
+            char buffer[blen];
+            struct buffer_rmcios p;
+
+            arc = crc_get_table (context, 16, 0x8005, 1);
+            p = param_to_buffer (context, paramtype, param, 0, blen, buffer);
+            return_int (context, returnv,
+                        (int) crc_update (arc->table, 1, 0,
+                                          (const unsigned char *) p.data,
+                                          p.length));
             break;
          }
          if (num_params < 1)       // Calculate and send
          {
-            unsigned short CRC16;
-            if (this->refout == 1)
-               CRC16 =
-                  this->
-                  xor_out ^ (BitReverseTable256[this->CRC16 >> 8] |
-                        BitReverseTable256[this->CRC16 & 0xFF] << 8);
-            else
-               CRC16 = this->xor_out ^ this->CRC16;
-
+            unsigned long long crc = crc_value (this);
+            char bytes[8];
+            int i;
+            for (i = 0; i < (this->width + 7) / 8; i++)
+               bytes[i] = (char) (crc >> (8 * i));
             write_binary (context, linked_channels (context, id),
-                  (char *) &CRC16, 2, 0, 0);
-            return_int (context, returnv, CRC16);
-            this->CRC16 = this->init;
+                  bytes, (this->width + 7) / 8, 0, 0);
+            crc_return (context, returnv, this->width, crc);
+            this->crc = crc_register (this, this->init);
             break;
          }
-
-         int blen = param_buffer_alloc_size (context, paramtype, param, 0);
+         if (this->tables == 0)
+            break;
+         if (paramtype == buffer_rmcios)
          {
+            // Calculate directly from the parameter buffer
+            crc_calculate (this, (const unsigned char *) param.bv[0].data,
+                           param.bv[0].length);
+         }
+         else
+         {
+            int blen = param_buffer_alloc_size (context, paramtype, param, 0);
             char buffer[blen];
             struct buffer_rmcios p;
-            int i;
             p = param_to_buffer (context, paramtype, param, 0, blen, buffer);
-            char *input = p.data;
-            for (i = 0; i < p.length; i++)
-            {
-               unsigned char byte = *(unsigned char *) input++;
-               if (this->refin == 1)
-                  byte = BitReverseTable256[byte];
-               unsigned short tableValue =
-                  this->crc16table[(((this->CRC16) >> 8) ^ byte) & SHIFTER];
-               this->CRC16 = ((this->CRC16) << 8) ^ tableValue;
-            }
+            crc_calculate (this, (const unsigned char *) p.data, p.length);
          }
          break;
    }
@@ -798,6 +3530,12 @@ void init_util_channels (const struct context_rmcios *context)
    create_channel_str (context, "modsum", (class_rmcios) checksum_class_func,
                        0);
    create_channel_str (context, "lcg", (class_rmcios) lcg_random_class_func, 0);
+   create_channel_str (context, "random", (class_rmcios) random_class_func,
+                       0);
    create_channel_str (context, "filter", (class_rmcios) filter_class_func, 0);
-   create_channel_str (context, "crc", (class_rmcios) crc16_class_func, 0);
+   create_channel_str (context, "deadband",
+                       (class_rmcios) deadband_class_func, 0);
+   create_channel_str (context, "ratelimit",
+                       (class_rmcios) ratelimit_class_func, 0);
+   create_channel_str (context, "crc", (class_rmcios) crc_class_func, 0);
 }